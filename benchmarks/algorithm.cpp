@@ -0,0 +1,239 @@
+//-----------------------------------------------------------------------------
+//
+// Device scan, copy_if and sort against std::execution::par
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <execution>
+#include <iostream>
+#include <numeric>
+#include <utility>
+
+#include "bench.hpp"
+
+namespace bench
+{
+namespace
+{
+
+std::vector<size_t> sizes(const options_t &options)
+{
+  std::vector<size_t> result = { 1 << 16, 1 << 20 };
+  if(!options.quick)
+    result.push_back(1 << 24);
+  return result;
+}
+
+std::vector<cl_uint> random_keys(size_t size)
+{
+  std::vector<cl_uint> keys(size);
+  cl_uint state = 2463534242u;
+  for(cl_uint &key : keys)
+  {
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    key = state;
+  }
+  return keys;
+}
+
+result_t make_result(const char *benchmark, const char *variant,
+                                               size_t size, double bytes)
+{
+  result_t result;
+  result.benchmark = benchmark;
+  result.variant = variant;
+  result.size = size;
+  result.local = "-";
+  result.bytes = bytes;
+  result.flops = double(size);
+  return result;
+}
+
+void check(env_t &env, bool correct, const char *benchmark, size_t size)
+{
+  if(!correct)
+  {
+    std::cerr << benchmark << " of " << size << " elements gave wrong "
+                                                                 "results\n";
+    ++env.failures;
+  }
+}
+
+} // namespace
+
+void bench_scan(env_t &env)
+{
+  for(size_t size : sizes(env.options))
+  {
+    std::vector<cl_uint> input(size);
+    for(size_t i = 0; i < size; ++i)
+      input[i] = cl_uint(i % 7);
+
+    std::vector<cl_uint> expected(size), output(size);
+    const double bytes = 2.0 * size * sizeof(cl_uint);
+
+    result_t host = make_result("scan", "std_par", size, bytes);
+    host.seconds = measure_cpu(env.options, [&]
+    {
+      std::exclusive_scan(std::execution::par, input.begin(), input.end(),
+                                                    expected.begin(), 0u);
+    });
+    env.reporter.add(std::move(host));
+
+    ocl2::Buffer<cl_uint> in(env.context, size, CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_uint> out(env.context, size);
+    env.queue.write(in, input.data());
+
+    result_t device = make_result("scan", "device", size, bytes);
+    device.seconds = measure_host(env.options, [&]
+    {
+      return ocl2::exclusive_scan(env.context, env.queue, in, out);
+    });
+    env.reporter.add(std::move(device));
+
+    env.queue.read(out, output.data());
+    check(env, output == expected, "scan", size);
+  }
+}
+
+void bench_copy_if(env_t &env)
+{
+  for(size_t size : sizes(env.options))
+  {
+    const std::vector<cl_uint> input = random_keys(size);
+    std::vector<cl_uint> expected(size), output(size);
+    size_t expected_count = 0;
+    const double bytes = 2.0 * size * sizeof(cl_uint);
+
+    result_t host = make_result("copy_if", "std_par", size, bytes);
+    host.seconds = measure_cpu(env.options, [&]
+    {
+      expected_count = std::copy_if(std::execution::par, input.begin(),
+                       input.end(), expected.begin(),
+                       [](cl_uint x) { return x % 3 == 0; }) -
+                                                            expected.begin();
+    });
+    env.reporter.add(std::move(host));
+
+    ocl2::Buffer<cl_uint> in(env.context, size, CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_uint> out(env.context, size);
+    ocl2::Buffer<cl_uint> count(env.context, 1);
+    env.queue.write(in, input.data());
+
+    result_t device = make_result("copy_if", "device", size, bytes);
+    device.seconds = measure_host(env.options, [&]
+    {
+      return ocl2::copy_if(env.context, env.queue, in, out, count,
+                                                                "x % 3 == 0");
+    });
+    env.reporter.add(std::move(device));
+
+    cl_uint output_count;
+    env.queue.read(count, &output_count);
+    env.queue.read(out, output.data());
+    check(env, output_count == expected_count &&
+               std::equal(output.begin(), output.begin() + expected_count,
+                                                        expected.begin()),
+                                                            "copy_if", size);
+  }
+}
+
+// Every run sorts a fresh copy of the same keys, the copy is timed on both
+// sides
+void bench_sort(env_t &env)
+{
+  for(size_t size : sizes(env.options))
+  {
+    const std::vector<cl_uint> keys = random_keys(size);
+    std::vector<cl_uint> values(size);
+    std::iota(values.begin(), values.end(), 0u);
+
+    std::vector<cl_uint> expected;
+    std::vector<std::pair<cl_uint, cl_uint>> expected_pairs(size);
+    const double bytes = 2.0 * size * sizeof(cl_uint);
+
+    result_t host_keys = make_result("sort", "keys_std_par", size, bytes);
+    host_keys.seconds = measure_cpu(env.options, [&]
+    {
+      expected = keys;
+      std::sort(std::execution::par, expected.begin(), expected.end());
+    });
+    env.reporter.add(std::move(host_keys));
+
+    result_t host_pairs = make_result("sort", "pairs_std_par", size,
+                                                                2 * bytes);
+    host_pairs.seconds = measure_cpu(env.options, [&]
+    {
+      for(size_t i = 0; i < size; ++i)
+        expected_pairs[i] = { keys[i], values[i] };
+      std::stable_sort(std::execution::par, expected_pairs.begin(),
+                       expected_pairs.end(),
+                       [](const std::pair<cl_uint, cl_uint> &a,
+                          const std::pair<cl_uint, cl_uint> &b)
+                       {
+                         return a.first < b.first;
+                       });
+    });
+    env.reporter.add(std::move(host_pairs));
+
+    ocl2::Buffer<cl_uint> keys_source(env.context, size, CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_uint> values_source(env.context, size, CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_uint> keys_buffer(env.context, size);
+    ocl2::Buffer<cl_uint> values_buffer(env.context, size);
+    env.queue.write(keys_source, keys.data());
+    env.queue.write(values_source, values.data());
+
+    std::vector<cl_uint> output_keys(size), output_values(size);
+
+    result_t device_keys = make_result("sort", "keys_device", size, bytes);
+    device_keys.seconds = measure_host(env.options, [&]
+    {
+      const ocl2::Event copied = ocl2::assign(env.context, env.queue,
+                                                 keys_buffer, keys_source);
+      return ocl2::sort(env.context, env.queue, keys_buffer, copied);
+    });
+    env.reporter.add(std::move(device_keys));
+
+    env.queue.read(keys_buffer, output_keys.data());
+    check(env, output_keys == expected, "sort", size);
+
+    result_t device_pairs = make_result("sort", "pairs_device", size,
+                                                                2 * bytes);
+    device_pairs.seconds = measure_host(env.options, [&]
+    {
+      const ocl2::Event keys_copied = ocl2::assign(env.context, env.queue,
+                                                 keys_buffer, keys_source);
+      const ocl2::Event values_copied = ocl2::assign(env.context, env.queue,
+                                             values_buffer, values_source);
+      return ocl2::sort_by_key(env.context, env.queue, keys_buffer,
+                       values_buffer, { keys_copied, values_copied });
+    });
+    env.reporter.add(std::move(device_pairs));
+
+    env.queue.read(keys_buffer, output_keys.data());
+    env.queue.read(values_buffer, output_values.data());
+
+    bool correct = true;
+    for(size_t i = 0; i < size && correct; ++i)
+    {
+      correct = output_keys[i] == expected_pairs[i].first &&
+                output_values[i] == expected_pairs[i].second;
+    }
+    check(env, correct, "sort_by_key", size);
+  }
+}
+
+} // namespace bench
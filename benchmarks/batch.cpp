@@ -0,0 +1,162 @@
+//-----------------------------------------------------------------------------
+//
+// Many small vec_adds as separate launches and coalesced by the batcher
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+namespace
+{
+
+enum { JOBS = 256 };
+
+result_t make_result(const std::string &variant, size_t size)
+{
+  result_t result;
+  result.benchmark = "batch";
+  result.variant = variant;
+  result.size = size;
+  result.local = "-";
+  result.bytes = 3.0 * JOBS * size * sizeof(cl_int);
+  return result;
+}
+
+} // namespace
+
+void bench_batch(env_t &env)
+{
+  ocl2::Program program = env.program("vec_add_kernel.cl");
+  ocl2::Kernel vec_add(program, "vec_add");
+
+  std::vector<size_t> sizes = { 64, 1 << 10 };
+  if(!env.options.quick)
+    sizes.push_back(1 << 14);
+
+  for(size_t size : sizes)
+  {
+    // Job j adds elements [j * size, (j + 1) * size), as its own buffers
+    // for the separate launches and as a slice of one buffer for the batch
+    std::vector<cl_int> A(JOBS * size), B(JOBS * size), C(JOBS * size);
+    for(size_t i = 0; i < A.size(); ++i)
+    {
+      A[i] = cl_int(i);
+      B[i] = cl_int(A.size() - i);
+    }
+
+    const std::vector<cl_int> job_zeros(size, 0);
+    std::vector<ocl2::Buffer<cl_int>> A_jobs, B_jobs, C_jobs;
+    for(size_t j = 0; j < JOBS; ++j)
+    {
+      A_jobs.emplace_back(env.context, size, CL_MEM_READ_ONLY);
+      B_jobs.emplace_back(env.context, size, CL_MEM_READ_ONLY);
+      C_jobs.emplace_back(env.context, size, CL_MEM_WRITE_ONLY);
+      env.queue.enqueue_write(A_jobs[j], A.data() + j * size);
+      env.queue.enqueue_write(B_jobs[j], B.data() + j * size);
+      env.queue.enqueue_write(C_jobs[j], job_zeros.data());
+    }
+
+    ocl2::Buffer<cl_int> A_all(env.context, A.size(), CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_int> B_all(env.context, B.size(), CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_int> C_all(env.context, C.size(), CL_MEM_WRITE_ONLY);
+    env.queue.enqueue_write(A_all, A.data());
+    env.queue.enqueue_write(B_all, B.data());
+    env.queue.finish();
+
+    result_t separate = make_result("separate", size);
+    separate.seconds = measure_host(env.options, [&]
+    {
+      for(size_t j = 0; j < JOBS; ++j)
+      {
+        vec_add.enqueue(env.queue, size, {}, A_jobs[j], B_jobs[j],
+                                                   C_jobs[j], cl_int(size));
+      }
+      return env.queue.enqueue_marker();
+    });
+    env.reporter.add(std::move(separate));
+
+    // Every element of A + B is A.size(), in each job as in the batch
+    bool separate_correct = true;
+    for(size_t j = 0; j < JOBS; ++j)
+    {
+      std::vector<cl_int> result(size);
+      env.queue.enqueue_read(C_jobs[j], result.data()).wait();
+
+      for(size_t i = 0; i < result.size(); ++i)
+      {
+        separate_correct = separate_correct &&
+                                         result[i] == cl_int(JOBS * size);
+      }
+    }
+
+    if(!separate_correct)
+    {
+      std::cerr << "batch separate of " << size
+                << " elements gave wrong results\n";
+      ++env.failures;
+    }
+
+    for(size_t max_batch : { 64, 256 })
+    {
+      const std::vector<cl_int> zeros(C.size(), 0);
+      env.queue.enqueue_write(C_all, zeros.data()).wait();
+
+      ocl2::BatchConfig config;
+      config.max_batch = max_batch;
+      ocl2::Batcher batcher(env.context, program, "vec_add_batched", config);
+      batcher.bind(A_all, B_all, C_all);
+
+      result_t batched = make_result("batched_" + std::to_string(max_batch),
+                                                                       size);
+      batched.seconds = measure_host(env.options, [&]
+      {
+        std::vector<std::future<ocl2::Event>> done;
+        for(size_t j = 0; j < JOBS; ++j)
+        {
+          const cl_uint offset = cl_uint(j * size);
+          done.push_back(batcher.submit({ { offset, offset, offset },
+                                                           cl_uint(size) }));
+        }
+        batcher.flush();
+
+        std::vector<ocl2::Event> events;
+        for(std::future<ocl2::Event> &event : done)
+          events.push_back(event.get());
+        return env.queue.enqueue_marker(events);
+      });
+      env.reporter.add(std::move(batched));
+
+      std::vector<cl_int> result(C.size());
+      env.queue.enqueue_read(C_all, result.data()).wait();
+
+      bool correct = true;
+      for(size_t i = 0; i < result.size(); ++i)
+        correct = correct && result[i] == cl_int(result.size());
+
+      if(!correct)
+      {
+        std::cerr << "batch " << max_batch << " of " << size
+                  << " elements gave wrong results\n";
+        ++env.failures;
+      }
+    }
+  }
+}
+
+} // namespace bench
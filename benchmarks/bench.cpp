@@ -0,0 +1,290 @@
+//-----------------------------------------------------------------------------
+//
+// Benchmark suite of the wrapper and the example kernels
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "bench.hpp"
+
+namespace bench
+{
+namespace
+{
+
+struct benchmark_t
+{
+  const char *name;
+  void (*run)(env_t &env);
+};
+
+const benchmark_t benchmarks[] =
+{
+  { "transfer", bench_transfer },
+  { "vec_add", bench_vec_add },
+  { "matrix_mult", bench_matrix_mult },
+  { "reduce", bench_reduce },
+  { "scan", bench_scan },
+  { "copy_if", bench_copy_if },
+  { "sort", bench_sort },
+  { "tasks", bench_tasks },
+  { "submit", bench_submit },
+  { "batch", bench_batch },
+};
+
+[[noreturn]] void fail(const std::string &message)
+{
+  std::cerr << "Fatal error: " << message << "\n";
+  std::exit(EXIT_FAILURE);
+}
+
+options_t configurate(int argc, const char **argv)
+{
+  options_t options;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if(arg == "--device=GPU")
+      options.type = CL_DEVICE_TYPE_GPU;
+    else if(arg == "--device=CPU")
+      options.type = CL_DEVICE_TYPE_CPU;
+    else if(arg == "--device=ALL")
+      options.type = CL_DEVICE_TYPE_ALL;
+    else if(arg.compare(0, 9, "--warmup=") == 0)
+      options.warmup = std::strtoull(argv[i] + 9, nullptr, 10);
+    else if(arg.compare(0, 7, "--runs=") == 0)
+      options.runs = std::strtoull(argv[i] + 7, nullptr, 10);
+    else if(arg == "--quick")
+      options.quick = true;
+    else if(arg == "--format=csv")
+      options.format = format_t::csv;
+    else if(arg == "--format=json")
+      options.format = format_t::json;
+    else if(arg.compare(0, 9, "--filter=") == 0)
+      options.filter = arg.substr(9);
+    else if(arg.compare(0, 10, "--kernels=") == 0)
+      options.kernels_dir = arg.substr(10);
+    else if(arg == "-o")
+    {
+      if(i + 1 == argc)
+        fail("missing filename after '-o'");
+      options.output = argv[++i];
+    }
+    else
+      fail("unrecognized command line option '" + arg + "'");
+  }
+
+  if(options.runs == 0)
+    fail("at least one timed run is needed");
+
+  return options;
+}
+
+std::string json_string(const std::string &str)
+{
+  std::string result = "\"";
+  for(char c : str)
+  {
+    if(c == '"' || c == '\\')
+      result += '\\';
+    result += c;
+  }
+  return result + "\"";
+}
+
+std::string csv_string(const std::string &str)
+{
+  std::string result = "\"";
+  for(char c : str)
+  {
+    if(c == '"')
+      result += '"';
+    result += c;
+  }
+  return result + "\"";
+}
+
+} // namespace
+
+
+
+double percentile(std::vector<double> values, double p)
+{
+  if(values.empty())
+    return 0.0;
+
+  std::sort(values.begin(), values.end());
+  const size_t rank = size_t(std::ceil(p * values.size()));
+  return values[rank == 0 ? 0 : rank - 1];
+}
+
+
+
+void Reporter::add(result_t result)
+{
+  const double median = percentile(result.seconds, 0.5);
+
+  std::cerr << std::left << std::setw(12) << result.benchmark << " "
+            << std::setw(20) << result.variant << " size " << std::setw(10)
+            << result.size << " local " << std::setw(8) << result.local
+            << std::right << std::fixed << std::setprecision(3)
+            << " median " << median * 1e3 << "ms\n";
+  std::cerr.unsetf(std::ios::floatfield);
+
+  results_.push_back(std::move(result));
+}
+
+
+
+void Reporter::write(std::ostream &os, format_t format,
+                     const ocl2::Device &device, const options_t &options) const
+{
+  const std::string device_name = device.name();
+  const std::string driver = device.info_string(CL_DRIVER_VERSION);
+
+  if(format == format_t::csv)
+  {
+    os << "device,driver,benchmark,variant,size,local,runs,min_ms,median_ms,"
+          "p95_ms,gb_per_s,gflops\n";
+  }
+  else
+  {
+    os << "{\n  \"device\": " << json_string(device_name)
+       << ",\n  \"driver\": " << json_string(driver)
+       << ",\n  \"warmup\": " << options.warmup
+       << ",\n  \"runs\": " << options.runs << ",\n  \"results\": [";
+  }
+
+  for(size_t i = 0; i < results_.size(); ++i)
+  {
+    const result_t &result = results_[i];
+    const double median = percentile(result.seconds, 0.5);
+    const double min = percentile(result.seconds, 0.0);
+    const double p95 = percentile(result.seconds, 0.95);
+    const double gb_per_s = median > 0 ? result.bytes * 1e-9 / median : 0.0;
+    const double gflops = median > 0 ? result.flops * 1e-9 / median : 0.0;
+
+    if(format == format_t::csv)
+    {
+      os << csv_string(device_name) << "," << csv_string(driver) << ","
+         << result.benchmark << "," << result.variant << "," << result.size
+         << "," << result.local << "," << result.seconds.size() << ","
+         << min * 1e3 << "," << median * 1e3 << "," << p95 * 1e3 << ","
+         << gb_per_s << "," << gflops << "\n";
+    }
+    else
+    {
+      os << (i == 0 ? "\n" : ",\n") << "    { \"benchmark\": "
+         << json_string(result.benchmark) << ", \"variant\": "
+         << json_string(result.variant) << ", \"size\": " << result.size
+         << ", \"local\": " << json_string(result.local)
+         << ", \"runs\": " << result.seconds.size()
+         << ", \"min_ms\": " << min * 1e3
+         << ", \"median_ms\": " << median * 1e3
+         << ", \"p95_ms\": " << p95 * 1e3
+         << ", \"gb_per_s\": " << gb_per_s
+         << ", \"gflops\": " << gflops << " }";
+    }
+  }
+
+  if(format == format_t::json)
+    os << "\n  ]\n}\n";
+}
+
+
+
+ocl2::Program env_t::program(const std::string &filename,
+                                            const std::string &build_options)
+{
+  return ocl2::Program::build_cached(context,
+                ocl2::read_file(options.kernels_dir + "/" + filename),
+                build_options);
+}
+
+
+
+std::string local_string(const ocl2::NDRange &range)
+{
+  if(range.local() == nullptr)
+    return "auto";
+
+  std::string result;
+  for(cl_uint i = 0; i < range.dims(); ++i)
+    result += (i == 0 ? "" : "x") + std::to_string(range.local()[i]);
+  return result;
+}
+
+
+
+size_t kernel_work_group_size(const ocl2::Kernel &kernel,
+                                                   const ocl2::Device &device)
+{
+  size_t size;
+  OCL2_CHECK(clGetKernelWorkGroupInfo(kernel.get(), device.get(),
+                  CL_KERNEL_WORK_GROUP_SIZE, sizeof(size), &size, nullptr));
+  return size;
+}
+
+} // namespace bench
+
+
+
+int main(int argc, const char **argv) try
+{
+  const bench::options_t options = bench::configurate(argc, argv);
+  bench::env_t env(options, ocl2::select_device(
+                                    ocl2::DeviceFilter().type(options.type)));
+
+  std::cerr << "Benchmarking " << env.context.device().name() << ", "
+            << options.warmup << " warmup and " << options.runs
+            << " timed runs\n";
+
+  for(const bench::benchmark_t &benchmark : bench::benchmarks)
+  {
+    if(options.filter.empty() || options.filter == benchmark.name)
+      benchmark.run(env);
+  }
+
+  if(options.output.empty())
+    env.reporter.write(std::cout, options.format, env.context.device(),
+                                                                     options);
+  else
+  {
+    std::ofstream file(options.output);
+    env.reporter.write(file, options.format, env.context.device(), options);
+    if(!file)
+      bench::fail("can't write '" + options.output + "'");
+  }
+
+  if(env.failures != 0)
+  {
+    std::cerr << "Error: " << env.failures << " benchmark(s) gave wrong "
+                                                                "results\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+catch(const std::exception &e)
+{
+  std::cerr << "Error: " << e.what() << "\n";
+  return EXIT_FAILURE;
+}
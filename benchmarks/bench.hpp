@@ -0,0 +1,179 @@
+//-----------------------------------------------------------------------------
+//
+// Benchmark harness: options, timing, statistics and reports
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "ocl2.hpp"
+
+#ifndef KERNELS_DIR
+#define KERNELS_DIR "examples/raw_ocl"
+#endif
+
+namespace bench
+{
+
+enum class format_t { csv, json };
+
+struct options_t
+{
+  cl_device_type type = CL_DEVICE_TYPE_ALL;
+  size_t warmup = 3;
+  size_t runs = 10;
+  bool quick = false;
+  format_t format = format_t::csv;
+  std::string output;
+  std::string filter;
+  std::string kernels_dir = KERNELS_DIR;
+};
+
+// Device time of every timed run of one configuration, rates are taken at
+// the median
+struct result_t
+{
+  std::string benchmark;
+  std::string variant;
+  size_t size = 0;
+  std::string local = "auto";
+  double bytes = 0.0;
+  double flops = 0.0;
+  std::vector<double> seconds;
+};
+
+// Nearest rank percentile, p in [0, 1]
+double percentile(std::vector<double> values, double p);
+
+class Reporter
+{
+public:
+  void add(result_t result);
+  void write(std::ostream &os, format_t format, const ocl2::Device &device,
+                                              const options_t &options) const;
+
+private:
+  std::vector<result_t> results_;
+};
+
+
+
+struct env_t
+{
+  env_t(const options_t &bench_options, const ocl2::Device &device)
+    : options(bench_options), context(device),
+      queue(context, CL_QUEUE_PROFILING_ENABLE)
+  {
+  }
+
+  ocl2::Program program(const std::string &filename,
+                                       const std::string &build_options = "");
+
+  options_t options;
+  ocl2::Context context;
+  ocl2::Queue queue;
+  Reporter reporter;
+  int failures = 0;
+};
+
+// Runs launch warmup times, then runs times, and returns device seconds of
+// the timed runs from event profiling. Every run is waited for, so runs
+// never overlap
+template <typename Launch>
+std::vector<double> measure(const options_t &options, Launch &&launch)
+{
+  for(size_t i = 0; i < options.warmup; ++i)
+    launch().wait();
+
+  std::vector<double> seconds;
+
+  for(size_t i = 0; i < options.runs; ++i)
+  {
+    ocl2::Event event = launch();
+    event.wait();
+    seconds.push_back((event.profiling(CL_PROFILING_COMMAND_END) -
+                       event.profiling(CL_PROFILING_COMMAND_START)) * 1e-9);
+  }
+
+  return seconds;
+}
+
+// Same as measure() with host time from the start of launch until the
+// event it returns is complete, for launches enqueueing several commands
+// and host code to compare with
+template <typename Launch>
+std::vector<double> measure_host(const options_t &options, Launch &&launch)
+{
+  using clock = std::chrono::steady_clock;
+
+  for(size_t i = 0; i < options.warmup; ++i)
+    launch().wait();
+
+  std::vector<double> seconds;
+
+  for(size_t i = 0; i < options.runs; ++i)
+  {
+    const clock::time_point start = clock::now();
+    launch().wait();
+    seconds.push_back(std::chrono::duration<double>(clock::now() -
+                                                         start).count());
+  }
+
+  return seconds;
+}
+
+// Host time of runs calls of f after warmup ones, for the host code the
+// device runs are compared with
+template <typename F>
+std::vector<double> measure_cpu(const options_t &options, F &&f)
+{
+  using clock = std::chrono::steady_clock;
+
+  for(size_t i = 0; i < options.warmup; ++i)
+    f();
+
+  std::vector<double> seconds;
+
+  for(size_t i = 0; i < options.runs; ++i)
+  {
+    const clock::time_point start = clock::now();
+    f();
+    seconds.push_back(std::chrono::duration<double>(clock::now() -
+                                                         start).count());
+  }
+
+  return seconds;
+}
+
+std::string local_string(const ocl2::NDRange &range);
+
+size_t kernel_work_group_size(const ocl2::Kernel &kernel,
+                                                  const ocl2::Device &device);
+
+// Benchmarks registered in bench.cpp
+void bench_transfer(env_t &env);
+void bench_vec_add(env_t &env);
+void bench_matrix_mult(env_t &env);
+void bench_reduce(env_t &env);
+void bench_scan(env_t &env);
+void bench_copy_if(env_t &env);
+void bench_sort(env_t &env);
+void bench_submit(env_t &env);
+void bench_tasks(env_t &env);
+void bench_batch(env_t &env);
+
+} // namespace bench
@@ -0,0 +1,153 @@
+//-----------------------------------------------------------------------------
+//
+// matrix_mult kernel variants over sizes and tile configurations
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <iostream>
+
+#include "bench.hpp"
+
+namespace bench
+{
+namespace
+{
+
+struct config_t
+{
+  const char *kernel_name;
+  size_t tile_size;       // local side for naive, 0 leaves it to the runtime
+  size_t work_per_thread;
+};
+
+const config_t configs[] =
+{
+  { "matrix_mult_naive", 0, 1 },
+  { "matrix_mult_naive", 8, 1 },
+  { "matrix_mult_naive", 16, 1 },
+  { "matrix_mult_tiled", 8, 1 },
+  { "matrix_mult_tiled", 16, 1 },
+  { "matrix_mult_blocked", 16, 2 },
+  { "matrix_mult_blocked", 16, 4 },
+  { "matrix_mult_blocked", 32, 8 },
+};
+
+size_t round_up(size_t value, size_t multiple)
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+ocl2::NDRange range_for(const config_t &config, size_t n, size_t k)
+{
+  const size_t ts = config.tile_size;
+  const size_t wpt = config.work_per_thread;
+
+  if(ts == 0)
+    return ocl2::NDRange({ n, k });
+
+  if(std::string(config.kernel_name) == "matrix_mult_naive")
+    return ocl2::NDRange({ round_up(n, ts), round_up(k, ts) }, { ts, ts });
+
+  return ocl2::NDRange({ round_up(k, ts), round_up(n, ts) / wpt },
+                                                           { ts, ts / wpt });
+}
+
+} // namespace
+
+
+
+void bench_matrix_mult(env_t &env)
+{
+  std::vector<size_t> sizes = { 256, 512 };
+  if(!env.options.quick)
+    sizes.push_back(1024);
+
+  for(size_t n : sizes)
+  {
+    std::vector<cl_int> A(n * n), B(n * n), C(n * n);
+    for(size_t i = 0; i < n * n; ++i)
+    {
+      A[i] = cl_int(i % 17);
+      B[i] = cl_int(i % 13) - 6;
+    }
+
+    ocl2::Buffer<cl_int> buffer_A(env.context, A.size(), CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_int> buffer_B(env.context, B.size(), CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_int> buffer_C(env.context, C.size(), CL_MEM_WRITE_ONLY);
+    env.queue.write(buffer_A, A.data());
+    env.queue.write(buffer_B, B.data());
+
+    // Multi-threaded host version, every device result is checked against it
+    std::vector<cl_int> expected(n * n);
+
+    result_t host;
+    host.benchmark = "matrix_mult";
+    host.variant = "host";
+    host.size = n;
+    host.local = "-";
+    host.bytes = 3.0 * n * n * sizeof(cl_int);
+    host.flops = 2.0 * n * n * n;
+    host.seconds = measure_cpu(env.options, [&]
+    {
+      ocl2::host::matrix_mult(A.data(), B.data(), expected.data(), n, n, n);
+    });
+    env.reporter.add(std::move(host));
+
+    for(const config_t &config : configs)
+    {
+      const size_t tile = config.tile_size == 0 ? 16 : config.tile_size;
+      const std::string options = "-DTILE_SIZE=" + std::to_string(tile) +
+                            " -DWPT=" + std::to_string(config.work_per_thread);
+
+      ocl2::Program program = env.program("matrix_mult_kernel.cl", options);
+      ocl2::Kernel kernel(program, config.kernel_name);
+
+      const ocl2::NDRange range = range_for(config, n, n);
+      if(range.local() != nullptr &&
+         range.local()[0] * range.local()[1] >
+                       kernel_work_group_size(kernel, env.context.device()))
+      {
+        continue;
+      }
+
+      const cl_int size = cl_int(n);
+
+      result_t result;
+      result.benchmark = "matrix_mult";
+      result.variant = std::string(config.kernel_name + 12);
+      if(config.work_per_thread > 1)
+        result.variant += "_wpt" + std::to_string(config.work_per_thread);
+      result.size = n;
+      result.local = local_string(range);
+      result.bytes = 3.0 * n * n * sizeof(cl_int);
+      result.flops = 2.0 * n * n * n;
+      result.seconds = measure(env.options, [&]
+      {
+        return kernel(env.queue, range, buffer_A, buffer_B, buffer_C,
+                                                           size, size, size);
+      });
+
+      env.queue.read(buffer_C, C.data());
+      if(!ocl2::host::compare(C.data(), expected.data(), C.size(),
+                                                                1).empty())
+      {
+        std::cerr << "matrix_mult " << result.variant << " " << result.local
+                                                << " gave wrong results\n";
+        ++env.failures;
+      }
+
+      env.reporter.add(std::move(result));
+    }
+  }
+}
+
+} // namespace bench
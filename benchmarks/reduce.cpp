@@ -0,0 +1,108 @@
+//-----------------------------------------------------------------------------
+//
+// Device reductions of buffers and expressions
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "bench.hpp"
+
+namespace bench
+{
+namespace
+{
+
+// Times the reduction of expr with op and checks the result against
+// expected
+template <typename T, typename E>
+void run_reduce(env_t &env, const std::string &variant, const E &expr,
+                const ocl2::ReduceOp &op, size_t size, size_t bytes,
+                                                             double expected)
+{
+  ocl2::Buffer<T> result(env.context, 1);
+
+  result_t run;
+  run.benchmark = "reduce";
+  run.variant = variant;
+  run.size = size;
+  run.local = "-";
+  run.bytes = double(bytes);
+  run.flops = double(size);
+  run.seconds = measure_host(env.options, [&]
+  {
+    return ocl2::enqueue_reduce(env.context, env.queue, expr, result, op);
+  });
+
+  T value;
+  env.queue.read(result, &value);
+  if(std::fabs(double(value) - expected) > 1e-4 * std::fabs(expected))
+  {
+    std::cerr << "reduce " << variant << " of " << size << " elements gave "
+                                    << value << ", not " << expected << "\n";
+    ++env.failures;
+  }
+
+  env.reporter.add(std::move(run));
+}
+
+} // namespace
+
+void bench_reduce(env_t &env)
+{
+  std::vector<size_t> sizes = { 1 << 16, 1 << 20 };
+  if(!env.options.quick)
+    sizes.push_back(1 << 24);
+
+  for(size_t size : sizes)
+  {
+    std::vector<cl_int> ints(size);
+    std::vector<cl_float> A(size), B(size);
+    for(size_t i = 0; i < size; ++i)
+    {
+      ints[i] = cl_int((i * 7919) % 1000);
+      A[i] = cl_float(i % 16);
+      B[i] = cl_float(i % 3);
+    }
+
+    ocl2::Buffer<cl_int> ints_buffer(env.context, size, CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_float> A_buffer(env.context, size, CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_float> B_buffer(env.context, size, CL_MEM_READ_ONLY);
+    env.queue.write(ints_buffer, ints.data());
+    env.queue.write(A_buffer, A.data());
+    env.queue.write(B_buffer, B.data());
+
+    double int_sum = 0.0, float_sum = 0.0, dot = 0.0;
+    for(size_t i = 0; i < size; ++i)
+    {
+      int_sum += ints[i];
+      float_sum += A[i];
+      dot += double(A[i]) * B[i];
+    }
+
+    run_reduce<cl_long>(env, "sum_int", ints_buffer, ocl2::ReduceOp::sum(),
+                        size, size * sizeof(cl_int), int_sum);
+    run_reduce<cl_int>(env, "max_int", ints_buffer, ocl2::ReduceOp::max(),
+                       size, size * sizeof(cl_int),
+                       *std::max_element(ints.begin(), ints.end()));
+    run_reduce<cl_float>(env, "sum_float", A_buffer, ocl2::ReduceOp::sum(),
+                         size, size * sizeof(cl_float), float_sum);
+    run_reduce<cl_float>(env, "dot_float", A_buffer * B_buffer,
+                         ocl2::ReduceOp::sum(), size,
+                         2 * size * sizeof(cl_float), dot);
+  }
+}
+
+} // namespace bench
@@ -0,0 +1,176 @@
+//-----------------------------------------------------------------------------
+//
+// Kernel launches from many host threads, global lock against the submitter
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+namespace
+{
+
+enum { LAUNCHES = 256, SIZE = 1 << 10 };
+
+// Every thread adds into its own C, so the launches of different threads
+// are independent
+struct buffers_t
+{
+  buffers_t(ocl2::Queue &queue, const ocl2::Context &context,
+                                                             size_t threads)
+    : A(context, SIZE, CL_MEM_READ_ONLY), B(context, SIZE, CL_MEM_READ_ONLY)
+  {
+    for(size_t t = 0; t < threads; ++t)
+      C.emplace_back(context, SIZE, CL_MEM_WRITE_ONLY);
+
+    std::vector<cl_int> host_A(SIZE), host_B(SIZE);
+    for(size_t i = 0; i < SIZE; ++i)
+    {
+      host_A[i] = cl_int(i);
+      host_B[i] = cl_int(SIZE - i);
+    }
+
+    queue.write(A, host_A.data());
+    queue.write(B, host_B.data());
+    clear(queue);
+  }
+
+  void clear(ocl2::Queue &queue)
+  {
+    const std::vector<cl_int> zeros(SIZE, 0);
+    for(ocl2::Buffer<cl_int> &buffer : C)
+      queue.write(buffer, zeros.data());
+  }
+
+  // Every C must hold A + B, then they are cleared for the next variant
+  bool check(ocl2::Queue &queue)
+  {
+    bool correct = true;
+    std::vector<cl_int> result(SIZE);
+    for(ocl2::Buffer<cl_int> &buffer : C)
+    {
+      queue.read(buffer, result.data());
+      for(size_t i = 0; i < SIZE; ++i)
+        correct = correct && result[i] == cl_int(SIZE);
+    }
+
+    clear(queue);
+    return correct;
+  }
+
+  ocl2::Buffer<cl_int> A, B;
+  std::vector<ocl2::Buffer<cl_int>> C;
+};
+
+template <typename Body>
+void on_threads(size_t threads, Body body)
+{
+  std::vector<std::thread> pool;
+  for(size_t t = 0; t < threads; ++t)
+    pool.emplace_back(body, t);
+  for(std::thread &thread : pool)
+    thread.join();
+}
+
+result_t make_result(const std::string &variant, size_t threads)
+{
+  result_t result;
+  result.benchmark = "submit";
+  result.variant = variant + "_" + std::to_string(threads) + "t";
+  result.size = SIZE;
+  result.local = "-";
+  result.bytes = 3.0 * threads * LAUNCHES * SIZE * sizeof(cl_int);
+  return result;
+}
+
+} // namespace
+
+void bench_submit(env_t &env)
+{
+  ocl2::Program program = env.program("vec_add_kernel.cl");
+
+  std::vector<size_t> thread_counts = { 1, 4 };
+  if(!env.options.quick)
+    thread_counts = { 1, 2, 4, 8, 16 };
+
+  for(size_t threads : thread_counts)
+  {
+    buffers_t buffers(env.queue, env.context, threads);
+
+    // Kernel arguments are shared state, so every launch holds the lock
+    // from the first clSetKernelArg until the enqueue returns
+    ocl2::Kernel kernel(program, "vec_add");
+    std::mutex mutex;
+
+    result_t locked = make_result("mutex", threads);
+    locked.seconds = measure_cpu(env.options, [&]
+    {
+      on_threads(threads, [&](size_t t)
+      {
+        ocl2::Event last;
+        for(size_t i = 0; i < LAUNCHES; ++i)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          last = kernel.enqueue(env.queue, SIZE, {}, buffers.A, buffers.B,
+                                              buffers.C[t], cl_int(SIZE));
+        }
+        last.wait();
+      });
+    });
+    env.reporter.add(std::move(locked));
+
+    if(!buffers.check(env.queue))
+    {
+      std::cerr << "submit mutex with " << threads
+                << " threads gave wrong results\n";
+      ++env.failures;
+    }
+
+    ocl2::Submitter submitter(env.context, program);
+
+    result_t submitted = make_result("submitter", threads);
+    submitted.seconds = measure_cpu(env.options, [&]
+    {
+      on_threads(threads, [&](size_t t)
+      {
+        ocl2::Submitter::Producer producer = submitter.producer();
+        std::future<ocl2::Event> last;
+        for(size_t i = 0; i < LAUNCHES; ++i)
+        {
+          last = producer.submit("vec_add", SIZE, {}, buffers.A, buffers.B,
+                                              buffers.C[t], cl_int(SIZE));
+        }
+        last.get().wait();
+      });
+    });
+    env.reporter.add(std::move(submitted));
+
+    // Launches of all shards must be complete before C is read
+    submitter.finish();
+    if(!buffers.check(env.queue))
+    {
+      std::cerr << "submit submitter with " << threads
+                << " threads gave wrong results\n";
+      ++env.failures;
+    }
+  }
+}
+
+} // namespace bench
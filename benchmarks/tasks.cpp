@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+//
+// Many small independent jobs through one queue and through the scheduler
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+namespace
+{
+
+enum { JOBS = 64 };
+
+// Buffers of one vec_add job, uploaded, added and downloaded on its own
+struct job_t
+{
+  job_t(const ocl2::Context &context, size_t size)
+    : A(size, 0), B(size, 0), C(size, 0),
+      buffer_A(context, size, CL_MEM_READ_ONLY),
+      buffer_B(context, size, CL_MEM_READ_ONLY),
+      buffer_C(context, size, CL_MEM_WRITE_ONLY)
+  {
+  }
+
+  std::vector<cl_int> A, B, C;
+  ocl2::Buffer<cl_int> buffer_A, buffer_B, buffer_C;
+};
+
+// Both uploads of a job are independent, the kernel waits for them and the
+// download for the kernel
+ocl2::TaskGraph job_graph(std::vector<job_t> &jobs, ocl2::Kernel &kernel)
+{
+  ocl2::TaskGraph graph;
+
+  for(job_t &job : jobs)
+  {
+    const ocl2::TaskId write_A = graph.add(
+          [&](ocl2::Queue &queue, const ocl2::WaitList &deps)
+          {
+            return queue.enqueue_write(job.buffer_A, job.A.data(), deps);
+          });
+
+    const ocl2::TaskId write_B = graph.add(
+          [&](ocl2::Queue &queue, const ocl2::WaitList &deps)
+          {
+            return queue.enqueue_write(job.buffer_B, job.B.data(), deps);
+          });
+
+    const ocl2::TaskId add = graph.add(
+          [&](ocl2::Queue &queue, const ocl2::WaitList &deps)
+          {
+            return kernel.enqueue(queue, job.A.size(), deps, job.buffer_A,
+                        job.buffer_B, job.buffer_C, cl_int(job.A.size()));
+          }, { write_A, write_B });
+
+    graph.add([&](ocl2::Queue &queue, const ocl2::WaitList &deps)
+              {
+                return queue.enqueue_read(job.buffer_C, job.C.data(), deps);
+              }, { add });
+  }
+
+  return graph;
+}
+
+} // namespace
+
+void bench_tasks(env_t &env)
+{
+  ocl2::Program program = env.program("vec_add_kernel.cl");
+  ocl2::Kernel kernel(program, "vec_add");
+
+  std::vector<size_t> sizes = { 1 << 10, 1 << 14 };
+  if(!env.options.quick)
+    sizes.push_back(1 << 18);
+
+  for(size_t size : sizes)
+  {
+    std::vector<job_t> jobs;
+    jobs.reserve(JOBS);
+    for(size_t j = 0; j < JOBS; ++j)
+    {
+      jobs.emplace_back(env.context, size);
+      for(size_t i = 0; i < size; ++i)
+      {
+        jobs[j].A[i] = cl_int(i + j);
+        jobs[j].B[i] = cl_int(size - i);
+      }
+    }
+
+    const ocl2::TaskGraph graph = job_graph(jobs, kernel);
+
+    std::vector<std::pair<std::string, ocl2::Scheduler>> schedulers;
+    schedulers.emplace_back("in_order", ocl2::Scheduler(env.context, 1));
+    schedulers.emplace_back("queues_4", ocl2::Scheduler(env.context, 4));
+    if(ocl2::Scheduler::supports_out_of_order(env.context.device()))
+    {
+      schedulers.emplace_back("out_of_order",
+                                  ocl2::Scheduler::out_of_order(env.context));
+    }
+
+    for(auto &[name, scheduler] : schedulers)
+    {
+      result_t result;
+      result.benchmark = "tasks";
+      result.variant = name;
+      result.size = size;
+      result.local = "-";
+      result.bytes = 3.0 * JOBS * size * sizeof(cl_int);
+      result.seconds = measure_host(env.options, [&]
+      {
+        const std::vector<ocl2::Event> events = scheduler.enqueue(graph);
+        return scheduler.queue(0).enqueue_marker(events);
+      });
+      env.reporter.add(std::move(result));
+
+      bool correct = true;
+      for(size_t j = 0; j < JOBS; ++j)
+      {
+        for(size_t i = 0; i < size; ++i)
+          correct = correct && jobs[j].C[i] == cl_int(size + j);
+        jobs[j].C.assign(size, 0);
+      }
+
+      if(!correct)
+      {
+        std::cerr << "tasks " << name << " of " << size
+                  << " elements gave wrong results\n";
+        ++env.failures;
+      }
+    }
+  }
+}
+
+} // namespace bench
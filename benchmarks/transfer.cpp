@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+//
+// Host to device and device to host bandwidth
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include "bench.hpp"
+
+namespace bench
+{
+
+void bench_transfer(env_t &env)
+{
+  std::vector<size_t> sizes = { 1 << 16, 1 << 20, 1 << 24 };
+  if(!env.options.quick)
+    sizes.push_back(1 << 26);
+
+  for(size_t bytes : sizes)
+  {
+    const size_t size = bytes / sizeof(cl_int);
+    std::vector<cl_int> host(size, 1);
+    ocl2::Buffer<cl_int> buffer(env.context, size);
+
+    result_t write;
+    write.benchmark = "transfer";
+    write.variant = "write";
+    write.size = bytes;
+    write.local = "-";
+    write.bytes = double(bytes);
+    write.seconds = measure(env.options, [&]
+    {
+      return env.queue.enqueue_write(buffer, host.data());
+    });
+    env.reporter.add(std::move(write));
+
+    result_t read;
+    read.benchmark = "transfer";
+    read.variant = "read";
+    read.size = bytes;
+    read.local = "-";
+    read.bytes = double(bytes);
+    read.seconds = measure(env.options, [&]
+    {
+      return env.queue.enqueue_read(buffer, host.data());
+    });
+    env.reporter.add(std::move(read));
+  }
+}
+
+} // namespace bench
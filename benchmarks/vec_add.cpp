@@ -0,0 +1,124 @@
+//-----------------------------------------------------------------------------
+//
+// vec_add kernel over sizes and work-group sizes
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench
+{
+
+namespace
+{
+
+// Kernel adding width elements per work-item, 1 is the scalar vec_add
+struct variant_t
+{
+  std::string name;
+  cl_uint width;
+  ocl2::Kernel kernel;
+};
+
+std::vector<variant_t> vec_add_variants(env_t &env)
+{
+  std::vector<variant_t> variants;
+
+  ocl2::Program scalar = env.program("vec_add_kernel.cl");
+  variants.push_back({ "scalar", 1, ocl2::Kernel(scalar, "vec_add") });
+
+  for(cl_uint width : { 4, 8, 16 })
+  {
+    ocl2::Program program = env.program("vec_add_kernel.cl",
+                                    "-DVEC_WIDTH=" + std::to_string(width));
+    variants.push_back({ "int" + std::to_string(width), width,
+                                      ocl2::Kernel(program, "vec_add_vec") });
+  }
+
+  return variants;
+}
+
+} // namespace
+
+void bench_vec_add(env_t &env)
+{
+  std::vector<variant_t> variants = vec_add_variants(env);
+
+  std::vector<size_t> sizes = { 1 << 16, 1 << 20 };
+  if(!env.options.quick)
+    sizes.push_back(1 << 24);
+
+  for(size_t size : sizes)
+  {
+    std::vector<cl_int> A(size), B(size), C(size);
+    for(size_t i = 0; i < size; ++i)
+    {
+      A[i] = cl_int(i);
+      B[i] = cl_int(size - i);
+    }
+
+    ocl2::Buffer<cl_int> buffer_A(env.context, size, CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_int> buffer_B(env.context, size, CL_MEM_READ_ONLY);
+    ocl2::Buffer<cl_int> buffer_C(env.context, size, CL_MEM_WRITE_ONLY);
+    env.queue.write(buffer_A, A.data());
+    env.queue.write(buffer_B, B.data());
+
+    for(variant_t &variant : variants)
+    {
+      const size_t max_local = kernel_work_group_size(variant.kernel,
+                                                      env.context.device());
+
+      // The kernels stride over the whole vector, so any global size works
+      const size_t items = (size + variant.width - 1) / variant.width;
+      std::vector<ocl2::NDRange> ranges = { ocl2::NDRange(items) };
+      for(size_t local : { 32, 64, 128, 256 })
+      {
+        if(local <= max_local)
+          ranges.push_back(ocl2::NDRange({ items }, { local }));
+      }
+
+      for(const ocl2::NDRange &range : ranges)
+      {
+        result_t result;
+        result.benchmark = "vec_add";
+        result.variant = variant.name;
+        result.size = size;
+        result.local = local_string(range);
+        result.bytes = 3.0 * size * sizeof(cl_int);
+        result.flops = double(size);
+        result.seconds = measure(env.options, [&]
+        {
+          return variant.kernel(env.queue, range, buffer_A, buffer_B,
+                                                      buffer_C, cl_int(size));
+        });
+
+        std::fill(C.begin(), C.end(), 0);
+        env.queue.read(buffer_C, C.data());
+        if(std::count(C.begin(), C.end(), cl_int(size)) != std::ptrdiff_t(size))
+        {
+          std::cerr << "vec_add " << variant.name << " " << result.local
+                                                  << " gave wrong results\n";
+          ++env.failures;
+        }
+
+        env.reporter.add(std::move(result));
+      }
+    }
+  }
+}
+
+} // namespace bench
@@ -0,0 +1,67 @@
+#------------------------------------------------------------------------------
+#
+# Writes a kernel source and its SPIR-V as a C/C++ header, run as
+#   cmake -DINPUT=<file.cl> -DNAME=<identifier> -DOUTPUT=<header>
+#         [-DSPIRV=<file.spv>] -P Ocl2EmbedFile.cmake
+#
+#------------------------------------------------------------------------------
+#
+# Copyright © 2020 Yuly Tarasov. All rights reserved.
+#
+#------------------------------------------------------------------------------
+#
+# This file is licensed after LGPL v3
+# Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+#
+#------------------------------------------------------------------------------
+
+# String literal of the file's bytes, each byte is a \x escape so there is
+# nothing to quote, 16 of them per line
+function(embed_literal file out_literal out_size)
+  file(READ ${file} hex HEX)
+  string(LENGTH "${hex}" length)
+  math(EXPR size "${length} / 2")
+
+  set(line "[0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f]")
+  string(REGEX REPLACE "(${line}${line}${line}${line})" "\\1\n" hex "${hex}")
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "\\\\x\\1" literal "${hex}")
+  string(REGEX REPLACE "\n$" "" literal "${literal}")
+  string(REPLACE "\n" "\"\n  \"" literal "${literal}")
+
+  set(${out_literal} "\"${literal}\"" PARENT_SCOPE)
+  set(${out_size} ${size} PARENT_SCOPE)
+endfunction()
+
+embed_literal(${INPUT} source source_size)
+
+if(DEFINED SPIRV AND EXISTS "${SPIRV}")
+  embed_literal(${SPIRV} spirv spirv_size)
+else()
+  set(spirv "\"\"")
+  set(spirv_size 0)
+endif()
+
+file(WRITE ${OUTPUT} "\
+// Generated by ocl2_embed_kernels() from ${INPUT}, do not edit
+
+#pragma once
+
+#include <stddef.h>
+
+#ifndef OCL2_EMBED_CONST
+#ifdef __cplusplus
+#define OCL2_EMBED_CONST constexpr
+#else
+#define OCL2_EMBED_CONST static const
+#endif
+#endif
+
+OCL2_EMBED_CONST char ${NAME}_source[] =
+  ${source};
+OCL2_EMBED_CONST size_t ${NAME}_source_size = ${source_size};
+
+// Empty when the source was not compiled to SPIR-V
+OCL2_EMBED_CONST char ${NAME}_spirv[] =
+  ${spirv};
+OCL2_EMBED_CONST size_t ${NAME}_spirv_size = ${spirv_size};
+")
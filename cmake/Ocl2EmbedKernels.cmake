@@ -0,0 +1,82 @@
+#------------------------------------------------------------------------------
+#
+# ocl2_embed_kernels(<target> <file.cl>... [SPIRV_OPTIONS <option>...])
+#
+# Embeds every kernel file in target as <name>.h, name being the file name
+# without extension: <name>_source is the text and <name>_spirv its SPIR-V,
+# both as constant char arrays usable from C and C++, with their sizes. The
+# headers are generated at build time and follow changes of the files.
+#
+# With OCL2_SPIRV on, sources are compiled to SPIR-V offline by clang and
+# llvm-spirv, SPIRV_OPTIONS are added to the clang command line (-D ...)
+#
+#------------------------------------------------------------------------------
+#
+# Copyright © 2020 Yuly Tarasov. All rights reserved.
+#
+#------------------------------------------------------------------------------
+#
+# This file is licensed after LGPL v3
+# Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+#
+#------------------------------------------------------------------------------
+
+option(OCL2_SPIRV "Compile embedded kernels to SPIR-V with clang and llvm-spirv"
+                                                                           OFF)
+
+set(OCL2_EMBED_SCRIPT ${CMAKE_CURRENT_LIST_DIR}/Ocl2EmbedFile.cmake)
+
+if(OCL2_SPIRV)
+  find_program(OCL2_CLANG NAMES clang)
+  find_program(OCL2_LLVM_SPIRV NAMES llvm-spirv)
+  if(NOT OCL2_CLANG OR NOT OCL2_LLVM_SPIRV)
+    message(WARNING "OCL2_SPIRV needs clang and llvm-spirv, kernels are "
+                    "embedded as source only")
+  endif()
+endif()
+
+function(ocl2_embed_kernels target)
+  cmake_parse_arguments(EMBED "" "" "SPIRV_OPTIONS" ${ARGN})
+
+  # Per target, two targets embedding one file don't share a rule
+  set(out_dir ${CMAKE_CURRENT_BINARY_DIR}/embedded_kernels/${target})
+  file(MAKE_DIRECTORY ${out_dir})
+
+  foreach(kernel IN LISTS EMBED_UNPARSED_ARGUMENTS)
+    get_filename_component(kernel ${kernel} ABSOLUTE)
+    get_filename_component(name ${kernel} NAME_WE)
+    string(MAKE_C_IDENTIFIER ${name} name)
+    set(header ${out_dir}/${name}.h)
+
+    set(spirv_args)
+    set(spirv_depends)
+    if(OCL2_SPIRV AND OCL2_CLANG AND OCL2_LLVM_SPIRV)
+      set(bitcode ${out_dir}/${name}.bc)
+      set(spirv ${out_dir}/${name}.spv)
+      add_custom_command(OUTPUT ${spirv}
+        COMMAND ${OCL2_CLANG} -x cl -cl-std=CL2.0
+                -target spir64-unknown-unknown -Xclang -finclude-default-header
+                -O2 -emit-llvm -c ${EMBED_SPIRV_OPTIONS} -o ${bitcode}
+                ${kernel}
+        COMMAND ${OCL2_LLVM_SPIRV} ${bitcode} -o ${spirv}
+        BYPRODUCTS ${bitcode}
+        DEPENDS ${kernel}
+        COMMENT "Compiling ${name} to SPIR-V"
+        VERBATIM
+      )
+      set(spirv_args -DSPIRV=${spirv})
+      set(spirv_depends ${spirv})
+    endif()
+
+    add_custom_command(OUTPUT ${header}
+      COMMAND ${CMAKE_COMMAND} -DINPUT=${kernel} -DNAME=${name}
+              -DOUTPUT=${header} ${spirv_args} -P ${OCL2_EMBED_SCRIPT}
+      DEPENDS ${kernel} ${spirv_depends} ${OCL2_EMBED_SCRIPT}
+      COMMENT "Embedding ${name}"
+      VERBATIM
+    )
+    target_sources(${target} PRIVATE ${header})
+  endforeach()
+
+  target_include_directories(${target} PRIVATE ${out_dir})
+endfunction()
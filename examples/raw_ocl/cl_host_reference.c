@@ -0,0 +1,316 @@
+//-----------------------------------------------------------------------------
+//
+// Multi-threaded host reference computations
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cl_host_reference.h"
+
+// Block of B is BLOCK_INNER rows of BLOCK_COLS elements, it stays in L2
+// while a block of BLOCK_ROWS rows of A goes over it. Inside the block
+// MICRO_ROWS x MICRO_COLS elements of C are kept in vector registers
+enum { BLOCK_ROWS = 16, BLOCK_INNER = 256, BLOCK_COLS = 256 };
+enum { MICRO_ROWS = 2, MICRO_COLS = 32 };
+
+// Baseline x86-64 has no 32-bit vector multiply, so an AVX2 version of the
+// multiplication is built too and picked at load time where it runs
+#if defined(__x86_64__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define SIMD_CLONES __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+
+#ifndef SIMD_CLONES
+#define SIMD_CLONES
+#endif
+
+// Elements of one comparison chunk, and mismatches a chunk collects before
+// merging them into the result
+enum { COMPARE_CHUNK = 1 << 16, COMPARE_BATCH = 64 };
+
+enum { MAX_THREADS = 256 };
+
+
+
+int cl_host_threads(void)
+{
+  const char *value = getenv("OCL2_HOST_THREADS");
+  int threads = value != NULL ? atoi(value) : 0;
+
+  if(threads <= 0)
+    threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+  if(threads <= 0)
+    return 1;
+
+  return threads < MAX_THREADS ? threads : MAX_THREADS;
+}
+
+
+
+// Runs work(arg) on the calling thread and threads - 1 new ones, work takes
+// chunks from a shared counter until there are none left
+static void run_threads(void *(*work)(void *), void *arg, int threads)
+{
+  pthread_t ids[MAX_THREADS];
+  int started = 0;
+
+  for(int i = 1; i < threads; ++i)
+  {
+    if(pthread_create(&ids[started], NULL, work, arg) != 0)
+      break;
+    ++started;
+  }
+
+  work(arg);
+
+  for(int i = 0; i < started; ++i)
+    pthread_join(ids[i], NULL);
+}
+
+static int threads_for(size_t chunks)
+{
+  const int threads = cl_host_threads();
+  return chunks < (size_t) threads ? (int) chunks : threads;
+}
+
+
+
+struct matrix_mult_t
+{
+  const cl_int *A;
+  const cl_int *B;
+  cl_int *C;
+  int n, m, k;
+  atomic_int next_block;
+};
+
+// Adds A[rows x inner] * B[inner x cols] to C[rows x cols], the constant
+// sizes of full tiles turn the loops into vector code after inlining
+static inline void micro_tile(const cl_int *A, const cl_int *B, cl_int *C,
+                              int m, int k, int inner, int rows, int cols)
+{
+  cl_int acc[MICRO_ROWS][MICRO_COLS];
+
+  for(int r = 0; r < rows; ++r)
+    for(int j = 0; j < cols; ++j)
+      acc[r][j] = C[(size_t) r * k + j];
+
+  for(int l = 0; l < inner; ++l)
+  {
+    const cl_int *b = B + (size_t) l * k;
+    for(int r = 0; r < rows; ++r)
+    {
+      const cl_int a = A[(size_t) r * m + l];
+      for(int j = 0; j < cols; ++j)
+        acc[r][j] += a * b[j];
+    }
+  }
+
+  for(int r = 0; r < rows; ++r)
+    for(int j = 0; j < cols; ++j)
+      C[(size_t) r * k + j] = acc[r][j];
+}
+
+SIMD_CLONES static void *matrix_mult_work(void *arg)
+{
+  struct matrix_mult_t *task = (struct matrix_mult_t *) arg;
+  const int m = task->m, k = task->k;
+
+  for(int row = atomic_fetch_add(&task->next_block, BLOCK_ROWS);
+      row < task->n; row = atomic_fetch_add(&task->next_block, BLOCK_ROWS))
+  {
+    const int row_end = row + BLOCK_ROWS < task->n ? row + BLOCK_ROWS :
+                                                     task->n;
+    memset(task->C + (size_t) row * k, 0,
+                                 sizeof(cl_int) * (size_t) (row_end - row) * k);
+
+    for(int inner = 0; inner < m; inner += BLOCK_INNER)
+    {
+      const int inner_size = inner + BLOCK_INNER < m ? BLOCK_INNER :
+                                                       m - inner;
+
+      for(int col = 0; col < k; col += BLOCK_COLS)
+      {
+        const int col_end = col + BLOCK_COLS < k ? col + BLOCK_COLS : k;
+
+        for(int i = row; i < row_end; i += MICRO_ROWS)
+        {
+          for(int j = col; j < col_end; j += MICRO_COLS)
+          {
+            const cl_int *A_tile = task->A + (size_t) i * m + inner;
+            const cl_int *B_tile = task->B + (size_t) inner * k + j;
+            cl_int *C_tile = task->C + (size_t) i * k + j;
+
+            if(i + MICRO_ROWS <= row_end && j + MICRO_COLS <= col_end)
+            {
+              micro_tile(A_tile, B_tile, C_tile, m, k, inner_size,
+                                                    MICRO_ROWS, MICRO_COLS);
+            }
+            else
+            {
+              micro_tile(A_tile, B_tile, C_tile, m, k, inner_size,
+                         row_end - i < MICRO_ROWS ? row_end - i : MICRO_ROWS,
+                         col_end - j < MICRO_COLS ? col_end - j : MICRO_COLS);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return NULL;
+}
+
+void cl_host_matrix_mult(const cl_int *A, const cl_int *B, cl_int *C,
+                                                          int n, int m, int k)
+{
+  struct matrix_mult_t task = { A, B, C, n, m, k, 0 };
+  run_threads(matrix_mult_work, &task,
+                       threads_for((size_t) (n + BLOCK_ROWS - 1) / BLOCK_ROWS));
+}
+
+
+
+struct compare_t
+{
+  const cl_int *actual;
+  const cl_int *expected;
+  size_t count;
+  size_t *mismatches;
+  size_t max_mismatches;
+  size_t stored; // guarded by mutex
+  pthread_mutex_t mutex;
+  atomic_size_t next_chunk;
+  // Lowest start of a chunk that found max_mismatches, no chunk starting
+  // after it can hold any of the first ones
+  atomic_size_t stop_at;
+};
+
+// Inserts increasing indices into the sorted mismatches, keeping the
+// lowest max_mismatches of them
+static void merge_mismatches(struct compare_t *task, const size_t *found,
+                                                              size_t count)
+{
+  if(count == 0)
+    return;
+
+  pthread_mutex_lock(&task->mutex);
+
+  size_t *result = task->mismatches;
+  for(size_t j = 0; j < count; ++j)
+  {
+    size_t size = task->stored;
+
+    // The rest of found is larger still
+    if(size == task->max_mismatches && found[j] > result[size - 1])
+      break;
+
+    // The largest one is dropped to make room
+    if(size == task->max_mismatches)
+      --size;
+
+    size_t pos = size;
+    for(; pos > 0 && result[pos - 1] > found[j]; --pos)
+      result[pos] = result[pos - 1];
+
+    result[pos] = found[j];
+    task->stored = size + 1;
+  }
+
+  pthread_mutex_unlock(&task->mutex);
+}
+
+static void lower_stop(struct compare_t *task, size_t begin)
+{
+  size_t current = atomic_load(&task->stop_at);
+  while(begin < current &&
+          !atomic_compare_exchange_weak(&task->stop_at, &current, begin))
+  {
+  }
+}
+
+static void *compare_work(void *arg)
+{
+  struct compare_t *task = (struct compare_t *) arg;
+
+  // Chunks are taken in increasing order, so once one starts after
+  // stop_at all the following ones do too
+  for(size_t begin = atomic_fetch_add(&task->next_chunk, COMPARE_CHUNK);
+      begin < task->count && begin <= atomic_load(&task->stop_at);
+      begin = atomic_fetch_add(&task->next_chunk, COMPARE_CHUNK))
+  {
+    const size_t end = begin + COMPARE_CHUNK < task->count ?
+                                        begin + COMPARE_CHUNK : task->count;
+    size_t batch[COMPARE_BATCH];
+    size_t batched = 0, in_chunk = 0;
+
+    for(size_t i = begin; i < end; ++i)
+    {
+      if(((i - begin) & 4095) == 0 && atomic_load_explicit(&task->stop_at,
+                                             memory_order_relaxed) < begin)
+      {
+        break;
+      }
+
+      if(task->actual[i] == task->expected[i])
+        continue;
+
+      batch[batched++] = i;
+      if(batched == COMPARE_BATCH)
+      {
+        merge_mismatches(task, batch, batched);
+        batched = 0;
+      }
+
+      if(++in_chunk == task->max_mismatches)
+      {
+        lower_stop(task, begin);
+        break;
+      }
+    }
+
+    merge_mismatches(task, batch, batched);
+  }
+
+  return NULL;
+}
+
+size_t cl_host_compare(const cl_int *actual, const cl_int *expected,
+                       size_t count, size_t *mismatches,
+                                                       size_t max_mismatches)
+{
+  if(max_mismatches == 0)
+    return 0;
+
+  struct compare_t task;
+  task.actual = actual;
+  task.expected = expected;
+  task.count = count;
+  task.mismatches = mismatches;
+  task.max_mismatches = max_mismatches;
+  task.stored = 0;
+  pthread_mutex_init(&task.mutex, NULL);
+  atomic_init(&task.next_chunk, 0);
+  atomic_init(&task.stop_at, count);
+
+  run_threads(compare_work, &task,
+                threads_for((count + COMPARE_CHUNK - 1) / COMPARE_CHUNK));
+
+  pthread_mutex_destroy(&task.mutex);
+  return task.stored;
+}
@@ -0,0 +1,43 @@
+//-----------------------------------------------------------------------------
+//
+// Multi-threaded host reference computations header file
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 210
+#endif
+
+#include <CL/cl.h>
+
+
+
+// Number of threads taken from OCL2_HOST_THREADS environment variable, all
+// online processors are used if it is not set
+int cl_host_threads(void);
+
+// C[n x k] = A[n x m] * B[m x k], all row-major. Blocks of rows of C are
+// spread over the threads, the innermost loop runs along rows of B and C
+// so that the compiler vectorizes it
+void cl_host_matrix_mult(const cl_int *A, const cl_int *B, cl_int *C,
+                                                         int n, int m, int k);
+
+// Compares count elements in parallel and stores indices of the first
+// max_mismatches mismatches in increasing order. A chunk that finds
+// max_mismatches on its own stops the chunks after it. Returns the number
+// of stored indices
+size_t cl_host_compare(const cl_int *actual, const cl_int *expected,
+                       size_t count, size_t *mismatches,
+                                                      size_t max_mismatches);
@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL command profiling
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <time.h>
+
+#include "cl_profiling.h"
+#include "cl_check_err.h"
+
+
+
+double cl_wall_seconds(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+
+
+cl_ulong cl_event_timestamp(cl_event event, cl_profiling_info param)
+{
+  cl_ulong timestamp;
+  cl_int ret = clGetEventProfilingInfo(event, param, sizeof(timestamp),
+                                                           &timestamp, NULL);
+  CL_CHECK_RET(ret);
+
+  return timestamp;
+}
+
+
+
+void cl_print_event_profile(const char *name, cl_event event, double bytes,
+                                                                 double flops)
+{
+  cl_ulong queued = cl_event_timestamp(event, CL_PROFILING_COMMAND_QUEUED);
+  cl_ulong start = cl_event_timestamp(event, CL_PROFILING_COMMAND_START);
+  cl_ulong end = cl_event_timestamp(event, CL_PROFILING_COMMAND_END);
+
+  double exec_time = (end - start) * 1e-9;
+
+  printf("%-12s queued %10.3fms, exec %10.3fms", name,
+                                     (start - queued) * 1e-6, exec_time * 1e3);
+
+  if(bytes != 0 && exec_time > 0)
+    printf(", %8.3f GB/s", bytes * 1e-9 / exec_time);
+  if(flops != 0 && exec_time > 0)
+    printf(", %8.3f GFLOPS", flops * 1e-9 / exec_time);
+
+  printf("\n");
+}
@@ -0,0 +1,38 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL command profiling header file
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 210
+#endif
+
+#include <CL/cl.h>
+
+
+
+// Monotonic wall clock in seconds, unlike clock() it keeps running while
+// the host waits for the device
+double cl_wall_seconds(void);
+
+// Device timestamp of the command in nanoseconds, the queue must have been
+// created with CL_QUEUE_PROFILING_ENABLE
+cl_ulong cl_event_timestamp(cl_event event, cl_profiling_info param);
+
+// Prints delay between enqueue and start, execution time and, when bytes or
+// flops are not 0, effective bandwidth and GFLOPS of a completed command
+void cl_print_event_profile(const char *name, cl_event event, double bytes,
+                                                                double flops);
@@ -0,0 +1,362 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL program binary cache
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cl_program_cache.h"
+#include "cl_check_err.h"
+
+
+
+enum { PATH_SIZE = 4096 };
+enum { INFO_SIZE = 1024 };
+
+static const char cache_magic[8] = { 'O', 'C', 'L', '2', 'P', 'R', 'G', '1' };
+
+
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size);
+static uint64_t program_key(cl_device_id device, const char *source,
+                                      size_t source_size, const char *options);
+static int make_dirs(const char *path);
+static cl_program load_cached(cl_context context, cl_device_id device,
+                              const char *path, const char *options,
+                              uint64_t key);
+static int store_cached(cl_program program, const char *path, uint64_t key);
+static int takes_spirv(cl_device_id device);
+
+
+
+const char *cl_program_cache_dir(void)
+{
+  static char dir[PATH_SIZE];
+
+  const char *env_dir = getenv("OCL2_PROGRAM_CACHE_DIR");
+  if(env_dir != NULL && env_dir[0] != '\0')
+  {
+    snprintf(dir, sizeof(dir), "%s", env_dir);
+    return dir;
+  }
+
+  const char *home = getenv("HOME");
+  snprintf(dir, sizeof(dir), "%s/.cache/ocl2/programs",
+                                                  (home != NULL) ? home : ".");
+  return dir;
+}
+
+
+
+cl_program cl_build_program_cached(cl_context context, cl_device_id device,
+                                   const char *source, size_t source_size,
+                                   const char *options, int use_cache,
+                                   int be_verbose)
+{
+  cl_int ret;
+  cl_program program;
+  char path[PATH_SIZE];
+  uint64_t key = 0;
+
+  if(use_cache)
+  {
+    key = program_key(device, source, source_size, options);
+    snprintf(path, sizeof(path), "%s/%016llx.bin", cl_program_cache_dir(),
+                                                     (unsigned long long) key);
+
+    program = load_cached(context, device, path, options, key);
+    if(program != NULL)
+    {
+      if(be_verbose)
+        printf("Program binary loaded from cache : %s\n", path);
+
+      return program;
+    }
+  }
+
+  program = clCreateProgramWithSource(context, 1, &source, &source_size, &ret);
+  CL_CHECK_RET(ret);
+
+  ret = clBuildProgram(program, 1, &device, options, NULL, NULL);
+  CL_CHECK_RET(ret);
+
+  if(use_cache)
+  {
+    if(store_cached(program, path, key) == 0 && be_verbose)
+      printf("Program binary stored to cache : %s\n", path);
+  }
+
+  return program;
+}
+
+
+
+cl_program cl_build_program_il(cl_context context, cl_device_id device,
+                               const void *il, size_t il_size,
+                               const char *options, int be_verbose)
+{
+  if(il_size == 0 || !takes_spirv(device))
+    return NULL;
+
+  cl_int ret;
+  cl_program program = clCreateProgramWithIL(context, il, il_size, &ret);
+  if(ret != CL_SUCCESS)
+    return NULL;
+
+  ret = clBuildProgram(program, 1, &device, options, NULL, NULL);
+  if(ret != CL_SUCCESS)
+  {
+    clReleaseProgram(program);
+    return NULL;
+  }
+
+  if(be_verbose)
+    printf("Program built from SPIR-V\n");
+
+  return program;
+}
+
+
+
+char *cl_read_source(const char *filename, size_t *size)
+{
+  FILE *file = fopen(filename, "rb");
+  if(file == NULL)
+    return NULL;
+
+  char *source = NULL;
+  long length;
+
+  if(fseek(file, 0, SEEK_END) != 0 || (length = ftell(file)) < 0 ||
+     fseek(file, 0, SEEK_SET) != 0)
+  {
+    goto out;
+  }
+
+  source = (char *) malloc(length + 1);
+  if(source == NULL)
+    goto out;
+
+  if(fread(source, 1, length, file) != (size_t) length)
+  {
+    free(source);
+    source = NULL;
+    goto out;
+  }
+
+  source[length] = '\0';
+  *size = length;
+
+out:
+  fclose(file);
+  return source;
+}
+
+
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+  const unsigned char *bytes = (const unsigned char *) data;
+
+  for(size_t i = 0; i < size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+
+
+static uint64_t program_key(cl_device_id device, const char *source,
+                                       size_t source_size, const char *options)
+{
+  cl_int ret;
+  char info[INFO_SIZE];
+  uint64_t hash = 14695981039346656037ull;
+
+  hash = fnv1a(hash, source, source_size);
+  hash = fnv1a(hash, "", 1);
+
+  ret = clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(info), info, NULL);
+  CL_CHECK_RET(ret);
+  hash = fnv1a(hash, info, strlen(info) + 1);
+
+  ret = clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(info), info, NULL);
+  CL_CHECK_RET(ret);
+  hash = fnv1a(hash, info, strlen(info) + 1);
+
+  if(options != NULL)
+    hash = fnv1a(hash, options, strlen(options));
+
+  return hash;
+}
+
+
+
+static int make_dirs(const char *path)
+{
+  char buf[PATH_SIZE];
+  snprintf(buf, sizeof(buf), "%s", path);
+
+  for(char *p = buf + 1; *p != '\0'; ++p)
+  {
+    if(*p != '/')
+      continue;
+
+    *p = '\0';
+    if(mkdir(buf, 0755) != 0 && errno != EEXIST)
+      return -1;
+    *p = '/';
+  }
+
+  if(mkdir(buf, 0755) != 0 && errno != EEXIST)
+    return -1;
+
+  return 0;
+}
+
+
+
+// Every failure here is a cache miss, the caller falls back to source build
+static cl_program load_cached(cl_context context, cl_device_id device,
+                              const char *path, const char *options,
+                              uint64_t key)
+{
+  FILE *file = fopen(path, "rb");
+  if(file == NULL)
+    return NULL;
+
+  cl_int ret;
+  cl_int binary_status;
+  char magic[sizeof(cache_magic)];
+  uint64_t stored_key;
+  uint64_t binary_size;
+  size_t size;
+  unsigned char *binary = NULL;
+  cl_program program = NULL;
+
+  if(fread(magic, sizeof(magic), 1, file) != 1 ||
+     memcmp(magic, cache_magic, sizeof(magic)) != 0 ||
+     fread(&stored_key, sizeof(stored_key), 1, file) != 1 ||
+     stored_key != key ||
+     fread(&binary_size, sizeof(binary_size), 1, file) != 1 ||
+     binary_size == 0)
+  {
+    goto out;
+  }
+
+  binary = (unsigned char *) malloc(binary_size);
+  if(binary == NULL || fread(binary, 1, binary_size, file) != binary_size)
+    goto out;
+
+  size = binary_size;
+  program = clCreateProgramWithBinary(context, 1, &device, &size,
+                  (const unsigned char **) &binary, &binary_status, &ret);
+  if(ret != CL_SUCCESS || binary_status != CL_SUCCESS)
+  {
+    if(program != NULL)
+      clReleaseProgram(program);
+    program = NULL;
+    goto out;
+  }
+
+  ret = clBuildProgram(program, 1, &device, options, NULL, NULL);
+  if(ret != CL_SUCCESS)
+  {
+    clReleaseProgram(program);
+    program = NULL;
+  }
+
+out:
+  free(binary);
+  fclose(file);
+
+  if(program == NULL)
+    remove(path);
+
+  return program;
+}
+
+
+
+// Binary is written to a temporary file first so that concurrent runs never
+// see a partially written entry
+static int store_cached(cl_program program, const char *path, uint64_t key)
+{
+  cl_int ret;
+  size_t binary_size;
+
+  ret = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES,
+                                       sizeof(binary_size), &binary_size, NULL);
+  if(ret != CL_SUCCESS || binary_size == 0)
+    return -1;
+
+  unsigned char *binary = (unsigned char *) malloc(binary_size);
+  if(binary == NULL)
+    return -1;
+
+  ret = clGetProgramInfo(program, CL_PROGRAM_BINARIES,
+                                           sizeof(binary), &binary, NULL);
+  if(ret != CL_SUCCESS || make_dirs(cl_program_cache_dir()) != 0)
+  {
+    free(binary);
+    return -1;
+  }
+
+  char tmp_path[PATH_SIZE];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long) getpid());
+
+  FILE *file = fopen(tmp_path, "wb");
+  if(file == NULL)
+  {
+    free(binary);
+    return -1;
+  }
+
+  uint64_t size = binary_size;
+  int written = fwrite(cache_magic, sizeof(cache_magic), 1, file) == 1 &&
+                fwrite(&key, sizeof(key), 1, file) == 1 &&
+                fwrite(&size, sizeof(size), 1, file) == 1 &&
+                fwrite(binary, 1, binary_size, file) == binary_size;
+
+  free(binary);
+
+  if(fclose(file) != 0 || !written || rename(tmp_path, path) != 0)
+  {
+    remove(tmp_path);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+// OpenCL 1.x devices don't know the query
+static int takes_spirv(cl_device_id device)
+{
+  char il_version[INFO_SIZE];
+  if(clGetDeviceInfo(device, CL_DEVICE_IL_VERSION, sizeof(il_version),
+                                             il_version, NULL) != CL_SUCCESS)
+  {
+    return 0;
+  }
+
+  return strstr(il_version, "SPIR-V") != NULL;
+}
@@ -0,0 +1,50 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL program binary cache header file
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 210
+#endif
+
+#include <CL/cl.h>
+
+
+
+// Directory is taken from OCL2_PROGRAM_CACHE_DIR environment variable,
+// $HOME/.cache/ocl2/programs is used if it is not set
+const char *cl_program_cache_dir(void);
+
+// Returns built program for single device. Binary is looked up in the cache
+// under the hash of source, device name, driver version and build options.
+// If there is no such binary or it fails to load, the program is built from
+// source and its binary is stored in the cache. Cache is bypassed completely
+// if use_cache is 0
+cl_program cl_build_program_cached(cl_context context, cl_device_id device,
+                                   const char *source, size_t source_size,
+                                   const char *options, int use_cache,
+                                   int be_verbose);
+
+// Returns program built from SPIR-V, or NULL if the device doesn't take
+// SPIR-V or rejects this module, the source is to be built then. Build
+// options can't change SPIR-V, -D options have no effect on it
+cl_program cl_build_program_il(cl_context context, cl_device_id device,
+                               const void *il, size_t il_size,
+                               const char *options, int be_verbose);
+
+// Reads the whole file, there is no limit on its size. Returned text is
+// null-terminated and freed by the caller, NULL means it can't be read
+char *cl_read_source(const char *filename, size_t *size);
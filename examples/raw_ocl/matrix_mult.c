@@ -18,7 +18,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
 #ifndef CL_TARGET_OPENCL_VERSION
 #define CL_TARGET_OPENCL_VERSION 210
@@ -27,10 +26,10 @@
 #include <CL/cl.h>
 
 #include "cl_check_err.h"
-
-#ifndef STD_KERNEL_FILENAME
-#define STD_KERNEL_FILENAME "matrix_mult_kernel.cl"
-#endif
+#include "cl_host_reference.h"
+#include "cl_profiling.h"
+#include "cl_program_cache.h"
+#include "matrix_mult_kernel.h"
 
 #ifndef CPU
 # ifndef GPU
@@ -40,11 +39,26 @@
 
 
 
-enum { KERNEL_SOURCE_SIZE = 32768 };
 enum { BUF_SIZE = 1024 };
 
 enum { N = 2024, M = 2024, K = 2024 };
 
+enum { STD_TILE_SIZE = 16, STD_WPT = 4 };
+
+enum variant_t
+{
+  VARIANT_NAIVE,
+  VARIANT_TILED,
+  VARIANT_BLOCKED
+};
+
+static const char *variant_kernel_names[] =
+{
+  "matrix_mult_naive",
+  "matrix_mult_tiled",
+  "matrix_mult_blocked"
+};
+
 
 struct config_t
 {
@@ -52,12 +66,17 @@ struct config_t
   int be_verbose;
   int with_timing;
   const char *kernel_filename;
+  int use_cache;
+  enum variant_t variant;
+  int tile_size;
+  int work_per_thread;
 };
 
 
 
 struct config_t configurate(int argc, const char **argv);
 cl_device_id detect_target_device_id(struct config_t config);
+size_t round_up(size_t value, size_t multiple);
 
 
 
@@ -83,41 +102,63 @@ int main(int argc, const char **argv)
       clCreateContext(0, 1, &target_device_id, NULL, NULL, &ret);
   CL_CHECK_RET(ret);
 
+  // Device times are taken from event timestamps, which are recorded by
+  // profiling queues only
+  cl_command_queue_properties queue_properties =
+                       config.with_timing ? CL_QUEUE_PROFILING_ENABLE : 0;
+
 #if CL_TARGET_OPENCL_VERSION < 200
-  cl_command_queue command_queue =
-                       clCreateCommandQueue(context, target_device_id, 0, &ret);
+  cl_command_queue command_queue = clCreateCommandQueue(context,
+                                   target_device_id, queue_properties, &ret);
 #else
-  cl_command_queue command_queue =
-      clCreateCommandQueueWithProperties(context, target_device_id, NULL, &ret);
+  cl_queue_properties queue_props[] =
+                               { CL_QUEUE_PROPERTIES, queue_properties, 0 };
+  cl_command_queue command_queue = clCreateCommandQueueWithProperties(context,
+                                       target_device_id, queue_props, &ret);
 #endif
   CL_CHECK_RET(ret);
 
 
 
-  FILE *kernel_source = fopen(config.kernel_filename, "r");
-  if(kernel_source == NULL)
+  // Kernels are embedded at build time, -k reads them from a file instead
+  const char *kernel_source_str = matrix_mult_kernel_source;
+  size_t kernel_source_size = matrix_mult_kernel_source_size;
+  char *kernel_file_str = NULL;
+
+  if(config.kernel_filename != NULL)
   {
-    fprintf(stderr, "Fatal error: can't open file '%s' with kernel\n",
+    kernel_file_str = cl_read_source(config.kernel_filename,
+                                                         &kernel_source_size);
+    if(kernel_file_str == NULL)
+    {
+      fprintf(stderr, "Fatal error: can't read file '%s' with kernel\n",
                                                         config.kernel_filename);
-    exit(EXIT_FAILURE);
+      exit(EXIT_FAILURE);
+    }
+    kernel_source_str = kernel_file_str;
   }
 
-  char *kernel_source_str = (char *) malloc(KERNEL_SOURCE_SIZE);
-  size_t kernel_source_size =
-                 fread(kernel_source_str, 1, KERNEL_SOURCE_SIZE, kernel_source);
-  fclose(kernel_source);
+  char build_options[BUF_SIZE];
+  snprintf(build_options, sizeof(build_options), "-DTILE_SIZE=%d -DWPT=%d",
+                                     config.tile_size, config.work_per_thread);
+
+  if(config.be_verbose)
+  {
+    printf("Kernel : %s\n", variant_kernel_names[config.variant]);
+    printf("Build options : %s\n", build_options);
+  }
 
   cl_program program =
-       clCreateProgramWithSource(context, 1, (const char **) &kernel_source_str,
-                                    (const size_t *) &kernel_source_size, &ret);
-  CL_CHECK_RET(ret);
+      cl_build_program_cached(context, target_device_id, kernel_source_str,
+                              kernel_source_size, build_options,
+                              config.use_cache, config.be_verbose);
 
 
-  ret = clBuildProgram(program, 1, &target_device_id, NULL, NULL, NULL);
-  CL_CHECK_RET(ret);
+  free(kernel_file_str);
 
 
-  cl_kernel kernel = clCreateKernel(program, "vec_add", &ret);
+  cl_kernel kernel =
+               clCreateKernel(program, variant_kernel_names[config.variant], &ret);
   CL_CHECK_RET(ret);
 
 
@@ -126,7 +167,6 @@ int main(int argc, const char **argv)
   cl_int *A = (cl_int *) malloc(sizeof(cl_int) * n * m);
   cl_int *B = (cl_int *) malloc(sizeof(cl_int) * m * k);
   cl_int *C = (cl_int *) malloc(sizeof(cl_int) * n * k);
-  cl_int *B_transposed = (cl_int *) malloc(sizeof(cl_int) * m * k);
   cl_int *C_CPU = (cl_int *) malloc(sizeof(cl_int) * n * k);
 
   for(int i = 0; i < n; ++i)
@@ -138,29 +178,16 @@ int main(int argc, const char **argv)
     for(int j = 0; j < k; ++j)
     {
       B[i * k + j] = (i * j) % (3 * (m + k));
-      B_transposed[j * m + i] = (i * j) % (3 * (m + k));
     }
   }
 
-  clock_t start, finish;
-  start = clock();
-  for(int i = 0; i < n; ++i)
-  {
-    for(int j = 0; j < k; ++j)
-    {
-      C_CPU[i * k + j] = 0;
-      for(int l = 0; l < m; ++l)
-      {
-        C_CPU[i * k + j] += A[i * m + l] * B_transposed[j * m + l];
-      }
-    }
-  }
-  finish = clock();
-  double cpu_time = (finish - start) / (double) CLOCKS_PER_SEC;
-  free(B_transposed);
+  double start = cl_wall_seconds();
+  cl_host_matrix_mult(A, B, C_CPU, n, m, k);
+  double cpu_time = cl_wall_seconds() - start;
   if(config.with_timing)
   {
-    printf("CPU calculating time: %gs\n", cpu_time);
+    printf("CPU calculating time (%d threads): %gs\n", cl_host_threads(),
+                                                                    cpu_time);
   }
 
 
@@ -179,20 +206,21 @@ int main(int argc, const char **argv)
 
 
 
-  ret = clEnqueueWriteBuffer(command_queue, memobj_A, CL_TRUE, 0,
-                                  sizeof(cl_int) * n * m, A, 0, NULL, NULL);
-  CL_CHECK_RET(ret);
+  // The queue is in-order, so the writes don't need to block: the kernel
+  // starts after them and the final blocking read is the only host sync
+  cl_event write_A_event, write_B_event, kernel_event, read_event;
 
-  ret = clEnqueueWriteBuffer(command_queue, memobj_B, CL_TRUE, 0,
-                                  sizeof(cl_int) * m * k, B, 0, NULL, NULL);
+  ret = clEnqueueWriteBuffer(command_queue, memobj_A, CL_FALSE, 0,
+                        sizeof(cl_int) * n * m, A, 0, NULL, &write_A_event);
   CL_CHECK_RET(ret);
 
-  ret = clEnqueueWriteBuffer(command_queue, memobj_C, CL_TRUE, 0,
-                                  sizeof(cl_int) * n * k, C, 0, NULL, NULL);
+  ret = clEnqueueWriteBuffer(command_queue, memobj_B, CL_FALSE, 0,
+                        sizeof(cl_int) * m * k, B, 0, NULL, &write_B_event);
   CL_CHECK_RET(ret);
 
 
 
+
   ret = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void *) &memobj_A);
   CL_CHECK_RET(ret);
 
@@ -202,62 +230,133 @@ int main(int argc, const char **argv)
   ret = clSetKernelArg(kernel, 2, sizeof(cl_mem), (void *) &memobj_C);
   CL_CHECK_RET(ret);
 
-  ret = clSetKernelArg(kernel, 3, sizeof(int), (void *) &m);
+  ret = clSetKernelArg(kernel, 3, sizeof(int), (void *) &n);
+  CL_CHECK_RET(ret);
+
+  ret = clSetKernelArg(kernel, 4, sizeof(int), (void *) &m);
+  CL_CHECK_RET(ret);
+
+  ret = clSetKernelArg(kernel, 5, sizeof(int), (void *) &k);
   CL_CHECK_RET(ret);
 
 
 
-  const size_t global_work_size[2] = { n, k };
+  size_t global_work_size[2] = { n, k };
+  size_t local_work_size[2] = { 0, 0 };
+  const size_t ts = config.tile_size;
+
+  switch(config.variant)
+  {
+  case VARIANT_NAIVE:
+    break;
+  case VARIANT_TILED:
+    global_work_size[0] = round_up(k, ts);
+    global_work_size[1] = round_up(n, ts);
+    local_work_size[0] = ts;
+    local_work_size[1] = ts;
+    break;
+  case VARIANT_BLOCKED:
+    global_work_size[0] = round_up(k, ts);
+    global_work_size[1] = round_up(n, ts) / config.work_per_thread;
+    local_work_size[0] = ts;
+    local_work_size[1] = ts / config.work_per_thread;
+    break;
+  }
+
+  const size_t *local_work_size_ptr =
+                  (config.variant == VARIANT_NAIVE) ? NULL : local_work_size;
 
   if(config.be_verbose)
   {
     printf("Global work size : %lux%lu\n", global_work_size[0],
                                            global_work_size[1]);
+    if(local_work_size_ptr != NULL)
+    {
+      printf("Local work size : %lux%lu\n", local_work_size[0],
+                                            local_work_size[1]);
+    }
   }
 
-  start = clock();
   ret = clEnqueueNDRangeKernel(command_queue, kernel, 2, NULL,
-                                         global_work_size, NULL, 0, NULL, NULL);
+             global_work_size, local_work_size_ptr, 0, NULL, &kernel_event);
   CL_CHECK_RET(ret);
 
 
   ret = clEnqueueReadBuffer(command_queue, memobj_C, CL_TRUE, 0,
-                                  sizeof(cl_int) * n * k , C, 0, NULL, NULL);
+                          sizeof(cl_int) * n * k , C, 0, NULL, &read_event);
   CL_CHECK_RET(ret);
-  finish = clock();
-  double target_time = (finish - start) / (double) CLOCKS_PER_SEC;
+
   if(config.with_timing)
   {
-    printf("Target device calculating time: %gs\n", target_time);
+    double matrices_bytes = sizeof(cl_int) * ((double) n * m +
+                                          (double) m * k + (double) n * k);
+
+    cl_print_event_profile("write A", write_A_event,
+                                           sizeof(cl_int) * (double) n * m, 0);
+    cl_print_event_profile("write B", write_B_event,
+                                           sizeof(cl_int) * (double) m * k, 0);
+    cl_print_event_profile("kernel", kernel_event, matrices_bytes,
+                                                    2.0 * n * (double) m * k);
+    cl_print_event_profile("read C", read_event,
+                                           sizeof(cl_int) * (double) n * k, 0);
+
+    cl_ulong first = cl_event_timestamp(write_A_event,
+                                                 CL_PROFILING_COMMAND_QUEUED);
+    cl_ulong last = cl_event_timestamp(read_event, CL_PROFILING_COMMAND_END);
+    printf("Target device calculating time: %gs\n", (last - first) * 1e-9);
   }
 
 
-  int errors = 0;
+  ret = clReleaseEvent(write_A_event);
+  CL_CHECK_RET(ret);
+  ret = clReleaseEvent(write_B_event);
+  CL_CHECK_RET(ret);
+  ret = clReleaseEvent(kernel_event);
+  CL_CHECK_RET(ret);
+  ret = clReleaseEvent(read_event);
+  CL_CHECK_RET(ret);
+  ret = clReleaseMemObject(memobj_A);
+  CL_CHECK_RET(ret);
+  ret = clReleaseMemObject(memobj_B);
+  CL_CHECK_RET(ret);
+  ret = clReleaseMemObject(memobj_C);
+  CL_CHECK_RET(ret);
+  ret = clReleaseKernel(kernel);
+  CL_CHECK_RET(ret);
+  ret = clReleaseProgram(program);
+  CL_CHECK_RET(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CL_CHECK_RET(ret);
+  ret = clReleaseContext(context);
+  CL_CHECK_RET(ret);
+
 
   if(config.be_verbose)
   {
     printf("Checking if calculations are correct...\n");
   }
 
-  for(int i = 0; i < n * k; ++i)
+  // Looking stops as soon as there are more errors than get printed
+  size_t mismatches[21];
+  int errors = (int) cl_host_compare(C, C_CPU, (size_t) n * k, mismatches,
+                                  sizeof(mismatches) / sizeof(mismatches[0]));
+
+  for(int e = 0; e < errors; ++e)
   {
-    if(C[i] != C_CPU[i])
-    {
-      printf("incorrect: C[%d:%d] == %d != %d\n", i / k, i % k, C[i], C_CPU[i]);
-      ++errors;
-    }
-    else if(config.be_verbose)
-    {
-      printf("C[%d:%d] element is correct!\n", i / k, i % k);
-    }
+    const int i = (int) mismatches[e];
+    printf("incorrect: C[%d:%d] == %d != %d\n", i / k, i % k, C[i], C_CPU[i]);
+  }
 
-    if(errors > 20)
-    {
-      printf("Too many errors...\n");
-      exit(EXIT_FAILURE);
-    }
+  if(errors > 20)
+  {
+    printf("Too many errors...\n");
   }
 
+  free(A);
+  free(B);
+  free(C);
+  free(C_CPU);
+
   if(errors == 0)
   {
     printf("Added correctly!\n");
@@ -288,7 +387,11 @@ struct config_t configurate(int argc, const char **argv)
 #endif
   config.be_verbose = 0;
   config.with_timing = 0;
-  config.kernel_filename = STD_KERNEL_FILENAME;
+  config.kernel_filename = NULL;
+  config.use_cache = 1;
+  config.variant = VARIANT_BLOCKED;
+  config.tile_size = STD_TILE_SIZE;
+  config.work_per_thread = STD_WPT;
 
   if(argc == 1)
   {
@@ -305,6 +408,10 @@ struct config_t configurate(int argc, const char **argv)
     {
       config.with_timing = 777;
     }
+    else if(strcmp(argv[i], "--no-cache") == 0)
+    {
+      config.use_cache = 0;
+    }
     else if(strcmp(argv[i], "-k") == 0)
     {
       if((argc - (i + 1)) > 0)
@@ -318,6 +425,36 @@ struct config_t configurate(int argc, const char **argv)
         exit(EXIT_FAILURE);
       }
     }
+    else if(strncmp(argv[i], "--variant=", 10) == 0)
+    {
+      const char *variant = argv[i] + 10;
+      if(strcmp(variant, "naive") == 0)
+      {
+        config.variant = VARIANT_NAIVE;
+      }
+      else if(strcmp(variant, "tiled") == 0)
+      {
+        config.variant = VARIANT_TILED;
+      }
+      else if(strcmp(variant, "blocked") == 0)
+      {
+        config.variant = VARIANT_BLOCKED;
+      }
+      else
+      {
+        fprintf(stderr, "Fatal error: unrecognized kernel variant '%s'\n",
+                                                                      variant);
+        exit(EXIT_FAILURE);
+      }
+    }
+    else if(strncmp(argv[i], "--tile=", 7) == 0)
+    {
+      config.tile_size = atoi(argv[i] + 7);
+    }
+    else if(strncmp(argv[i], "--wpt=", 6) == 0)
+    {
+      config.work_per_thread = atoi(argv[i] + 6);
+    }
     else if(strncmp(argv[i], "--device=", 9) == 0)
     {
       const char *device = argv[i] + 9;
@@ -349,11 +486,27 @@ struct config_t configurate(int argc, const char **argv)
     }
   }
 
+  if(config.tile_size <= 0 || config.work_per_thread <= 0 ||
+                                 config.tile_size % config.work_per_thread != 0)
+  {
+    fprintf(stderr, "Fatal error: tile size %d is not divisible by "
+                                                 "work per thread %d\n",
+                                   config.tile_size, config.work_per_thread);
+    exit(EXIT_FAILURE);
+  }
+
   return config;
 }
 
 
 
+size_t round_up(size_t value, size_t multiple)
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+
+
 cl_device_id detect_target_device_id(struct config_t config)
 {
   cl_device_id target_device_id;
@@ -1,13 +1,35 @@
-__kernel void vec_add(__global int *A, __global int *B, __global int *C, int m)
+// A[n x m] * B[m x k] = C[n x k]
+//
+// Tiled variants are configured with build options:
+//   -DTILE_SIZE=<ts>  side of the square tile staged in local memory
+//   -DWPT=<wpt>       outputs per work-item in matrix_mult_blocked,
+//                     TILE_SIZE must be divisible by WPT
+
+#ifndef TILE_SIZE
+#define TILE_SIZE 16
+#endif
+
+#ifndef WPT
+#define WPT 4
+#endif
+
+#define RTS (TILE_SIZE / WPT)
+
+
+
+// global size : n x k
+__kernel void matrix_mult_naive(__global int *A, __global int *B,
+                                __global int *C, int n, int m, int k)
 {
   if(get_work_dim() != 2)
     return;
 
-  size_t k = get_global_size(1);
-
   size_t i = get_global_id(0); // n index
   size_t j = get_global_id(1); // k index
 
+  if(i >= n || j >= k)
+    return;
+
   C[i * k + j] = 0;
 
   for(int l = 0; l < m; ++l)
@@ -16,3 +38,102 @@ __kernel void vec_add(__global int *A, __global int *B, __global int *C, int m)
   }
 }
 
+
+
+// global size : k x n rounded up to TILE_SIZE
+// local size  : TILE_SIZE x TILE_SIZE
+__kernel __attribute__((reqd_work_group_size(TILE_SIZE, TILE_SIZE, 1)))
+void matrix_mult_tiled(const __global int *A, const __global int *B,
+                       __global int *C, int n, int m, int k)
+{
+  __local int A_tile[TILE_SIZE][TILE_SIZE];
+  __local int B_tile[TILE_SIZE][TILE_SIZE];
+
+  const int col = get_local_id(0);
+  const int row = get_local_id(1);
+  const int global_col = get_group_id(0) * TILE_SIZE + col; // k index
+  const int global_row = get_group_id(1) * TILE_SIZE + row; // n index
+
+  int acc = 0;
+
+  for(int t = 0; t < m; t += TILE_SIZE)
+  {
+    const int a_col = t + col;
+    const int b_row = t + row;
+
+    A_tile[row][col] =
+               (global_row < n && a_col < m) ? A[global_row * m + a_col] : 0;
+    B_tile[row][col] =
+               (b_row < m && global_col < k) ? B[b_row * k + global_col] : 0;
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int l = 0; l < TILE_SIZE; ++l)
+    {
+      acc += A_tile[row][l] * B_tile[l][col];
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  if(global_row < n && global_col < k)
+    C[global_row * k + global_col] = acc;
+}
+
+
+
+// Every work-item computes WPT elements of one column of the tile, rows
+// are strided by RTS so that neighbouring work-items touch neighbouring
+// addresses
+//
+// global size : k x n rounded up to TILE_SIZE, second dimension / WPT
+// local size  : TILE_SIZE x (TILE_SIZE / WPT)
+__kernel __attribute__((reqd_work_group_size(TILE_SIZE, RTS, 1)))
+void matrix_mult_blocked(const __global int *A, const __global int *B,
+                         __global int *C, int n, int m, int k)
+{
+  __local int A_tile[TILE_SIZE][TILE_SIZE];
+  __local int B_tile[TILE_SIZE][TILE_SIZE];
+
+  const int col = get_local_id(0);
+  const int row = get_local_id(1);
+  const int global_col = get_group_id(0) * TILE_SIZE + col;
+  const int first_row = get_group_id(1) * TILE_SIZE + row;
+
+  int acc[WPT];
+  for(int w = 0; w < WPT; ++w)
+    acc[w] = 0;
+
+  for(int t = 0; t < m; t += TILE_SIZE)
+  {
+    for(int w = 0; w < WPT; ++w)
+    {
+      const int tile_row = row + w * RTS;
+      const int a_row = first_row + w * RTS;
+      const int b_row = t + tile_row;
+
+      A_tile[tile_row][col] =
+                       (a_row < n && t + col < m) ? A[a_row * m + t + col] : 0;
+      B_tile[tile_row][col] =
+                  (b_row < m && global_col < k) ? B[b_row * k + global_col] : 0;
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(int l = 0; l < TILE_SIZE; ++l)
+    {
+      const int b = B_tile[l][col];
+      for(int w = 0; w < WPT; ++w)
+        acc[w] += A_tile[row + w * RTS][l] * b;
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  for(int w = 0; w < WPT; ++w)
+  {
+    const int global_row = first_row + w * RTS;
+    if(global_row < n && global_col < k)
+      C[global_row * k + global_col] = acc[w];
+  }
+}
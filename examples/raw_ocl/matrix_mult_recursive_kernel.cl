@@ -0,0 +1,93 @@
+// A[n x m] * B[m x k] = C[n x k], subdivided on the device
+//
+// The host launches matrix_mult_recursive as one work-item over all of C.
+// A block of C with a side longer than leaf is split in half along its
+// longer side and both halves are enqueued as children on the default
+// device queue, smaller blocks are multiplied by a child NDRange of one
+// work-item per element. No step goes back to the host, and the launch is
+// complete once all of its descendants are.
+//
+// Needs OpenCL C 2.0 with device-side enqueue: -cl-std=CL2.0
+
+#if __OPENCL_C_VERSION__ == 200 || defined(__opencl_c_device_enqueue)
+
+// First half of size, a multiple of leaf so most leaves are full. size
+// must be larger than leaf
+int split(int size, int leaf)
+{
+  return (size / 2 + leaf - 1) / leaf * leaf;
+}
+
+
+
+// Enqueues that failed, e.g. for a full device queue, count in failed[0]
+__kernel void matrix_mult_block(const __global int *A, const __global int *B,
+                                __global int *C, int m, int k, int row,
+                                int col, int rows, int cols, int leaf,
+                                __global int *failed)
+{
+  const queue_t queue = get_default_queue();
+
+  if(rows <= leaf && cols <= leaf)
+  {
+    // global size : cols x rows
+    const size_t sizes[2] = { (size_t)cols, (size_t)rows };
+    const int ret = enqueue_kernel(queue, CLK_ENQUEUE_FLAGS_NO_WAIT,
+                                   ndrange_2D(sizes),
+                                   ^{
+                                     const int i = row + (int)get_global_id(1);
+                                     const int j = col + (int)get_global_id(0);
+
+                                     int acc = 0;
+                                     for(int l = 0; l < m; ++l)
+                                       acc += A[i * m + l] * B[l * k + j];
+
+                                     C[i * k + j] = acc;
+                                   });
+    if(ret != CLK_SUCCESS)
+      atomic_inc(failed);
+
+    return;
+  }
+
+  const bool by_rows = rows >= cols;
+  const int first_size = split(by_rows ? rows : cols, leaf);
+
+  const int first = enqueue_kernel(queue, CLK_ENQUEUE_FLAGS_NO_WAIT,
+                                   ndrange_1D(1),
+                                   ^{
+                                     matrix_mult_block(A, B, C, m, k, row,
+                                         col, by_rows ? first_size : rows,
+                                         by_rows ? cols : first_size, leaf,
+                                         failed);
+                                   });
+
+  const int second = enqueue_kernel(queue, CLK_ENQUEUE_FLAGS_NO_WAIT,
+                                    ndrange_1D(1),
+                                    ^{
+                                      matrix_mult_block(A, B, C, m, k,
+                                          by_rows ? row + first_size : row,
+                                          by_rows ? col : col + first_size,
+                                          by_rows ? rows - first_size : rows,
+                                          by_rows ? cols : cols - first_size,
+                                          leaf, failed);
+                                    });
+
+  if(first != CLK_SUCCESS)
+    atomic_inc(failed);
+  if(second != CLK_SUCCESS)
+    atomic_inc(failed);
+}
+
+
+
+// global size : 1
+__kernel void matrix_mult_recursive(const __global int *A,
+                                    const __global int *B, __global int *C,
+                                    int n, int m, int k, int leaf,
+                                    __global int *failed)
+{
+  matrix_mult_block(A, B, C, m, k, 0, 0, n, k, leaf, failed);
+}
+
+#endif
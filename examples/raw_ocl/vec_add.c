@@ -24,10 +24,8 @@
 #include <CL/cl.h>
 
 #include "cl_check_err.h"
-
-#ifndef STD_KERNEL_FILENAME
-#define STD_KERNEL_FILENAME "vec_add_kernel.cl"
-#endif
+#include "cl_program_cache.h"
+#include "vec_add_kernel.h"
 
 #ifndef CPU
 # ifndef GPU
@@ -37,7 +35,6 @@
 
 
 
-enum { KERNEL_SOURCE_SIZE = 32768 };
 enum { BUF_SIZE = 1024 };
 enum { VEC_SIZE = 1048576 };
 
@@ -48,6 +45,7 @@ struct config_t
   cl_device_type type;
   int be_verbose;
   const char *kernel_filename;
+  int use_cache;
 };
 
 
@@ -115,27 +113,45 @@ int main(int argc, const char **argv)
 
 
 
-  FILE *kernel_source = fopen(config.kernel_filename, "r");
-  if(kernel_source == NULL)
+  // Kernels are embedded at build time, -k reads them from a file instead
+  const char *kernel_source_str = vec_add_kernel_source;
+  size_t kernel_source_size = vec_add_kernel_source_size;
+  char *kernel_file_str = NULL;
+
+  if(config.kernel_filename != NULL)
   {
-    fprintf(stderr, "Fatal error: can't open file '%s' with kernel\n",
+    kernel_file_str = cl_read_source(config.kernel_filename,
+                                                         &kernel_source_size);
+    if(kernel_file_str == NULL)
+    {
+      fprintf(stderr, "Fatal error: can't read file '%s' with kernel\n",
                                                         config.kernel_filename);
-    exit(EXIT_FAILURE);
+      exit(EXIT_FAILURE);
+    }
+    kernel_source_str = kernel_file_str;
   }
 
-  char *kernel_source_str = (char *) malloc(KERNEL_SOURCE_SIZE);
-  size_t kernel_source_size =
-                 fread(kernel_source_str, 1, KERNEL_SOURCE_SIZE, kernel_source);
-  fclose(kernel_source);
+  // SPIR-V compiled offline skips the compiler front end, it only exists
+  // for the embedded kernels
+  cl_program program = NULL;
+  if(kernel_file_str == NULL)
+  {
+    program = cl_build_program_il(context, target_device_id,
+                                  vec_add_kernel_spirv,
+                                  vec_add_kernel_spirv_size, NULL,
+                                  config.be_verbose);
+  }
 
-  cl_program program =
-       clCreateProgramWithSource(context, 1, (const char **) &kernel_source_str,
-                                    (const size_t *) &kernel_source_size, &ret);
-  CL_CHECK_RET(ret);
+  if(program == NULL)
+  {
+    program = cl_build_program_cached(context, target_device_id,
+                                      kernel_source_str, kernel_source_size,
+                                      NULL, config.use_cache,
+                                      config.be_verbose);
+  }
 
 
-  ret = clBuildProgram(program, 1, &target_device_id, NULL, NULL, NULL);
-  CL_CHECK_RET(ret);
+  free(kernel_file_str);
 
 
   cl_kernel kernel = clCreateKernel(program, "vec_add", &ret);
@@ -170,17 +186,16 @@ int main(int argc, const char **argv)
 
 
 
-  ret = clEnqueueWriteBuffer(command_queue, memobj_A, CL_TRUE, 0,
+  // The queue is in-order, so the writes don't need to block: the kernel
+  // starts after them and the final blocking read is the only host sync
+  ret = clEnqueueWriteBuffer(command_queue, memobj_A, CL_FALSE, 0,
                                   mem_lenth * sizeof(cl_int), A, 0, NULL, NULL);
   CL_CHECK_RET(ret);
 
-  ret = clEnqueueWriteBuffer(command_queue, memobj_B, CL_TRUE, 0,
+  ret = clEnqueueWriteBuffer(command_queue, memobj_B, CL_FALSE, 0,
                                   mem_lenth * sizeof(cl_int), B, 0, NULL, NULL);
   CL_CHECK_RET(ret);
 
-  ret = clEnqueueWriteBuffer(command_queue, memobj_C, CL_TRUE, 0,
-                                  mem_lenth * sizeof(cl_int), C, 0, NULL, NULL);
-  CL_CHECK_RET(ret);
 
 
 
@@ -193,7 +208,7 @@ int main(int argc, const char **argv)
   ret = clSetKernelArg(kernel, 2, sizeof(cl_mem), (void *) &memobj_C);
   CL_CHECK_RET(ret);
 
-  ret = clSetKernelArg(kernel, 3, sizeof(size_t), (void *) &mem_lenth);
+  ret = clSetKernelArg(kernel, 3, sizeof(int), (void *) &mem_lenth);
   CL_CHECK_RET(ret);
 
 
@@ -215,6 +230,22 @@ int main(int argc, const char **argv)
   CL_CHECK_RET(ret);
 
 
+  ret = clReleaseMemObject(memobj_A);
+  CL_CHECK_RET(ret);
+  ret = clReleaseMemObject(memobj_B);
+  CL_CHECK_RET(ret);
+  ret = clReleaseMemObject(memobj_C);
+  CL_CHECK_RET(ret);
+  ret = clReleaseKernel(kernel);
+  CL_CHECK_RET(ret);
+  ret = clReleaseProgram(program);
+  CL_CHECK_RET(ret);
+  ret = clReleaseCommandQueue(command_queue);
+  CL_CHECK_RET(ret);
+  ret = clReleaseContext(context);
+  CL_CHECK_RET(ret);
+
+
   int errors = 0;
 
   for(size_t i = 0; i < mem_lenth; ++i)
@@ -234,6 +265,10 @@ int main(int argc, const char **argv)
     }
   }
 
+  free(A);
+  free(B);
+  free(C);
+
   if(errors == 0)
   {
     printf("Added correctly!\n");
@@ -263,7 +298,8 @@ struct config_t configurate(int argc, const char **argv)
   config.type = CL_DEVICE_TYPE_CPU;
 #endif
   config.be_verbose = 0;
-  config.kernel_filename = STD_KERNEL_FILENAME;
+  config.kernel_filename = NULL;
+  config.use_cache = 1;
 
   if(argc == 1)
   {
@@ -276,6 +312,10 @@ struct config_t configurate(int argc, const char **argv)
     {
       config.be_verbose = 1;
     }
+    else if(strcmp(argv[i], "--no-cache") == 0)
+    {
+      config.use_cache = 0;
+    }
     else if(strcmp(argv[i], "-k") == 0)
     {
       if((argc - (i + 1)) > 0)
@@ -12,3 +12,64 @@ __kernel void vec_add(__global int *A, __global int *B,
   }
 }
 
+
+
+// Vectorized vec_add, VEC_WIDTH is 2, 4, 8 or 16 and set with
+// -DVEC_WIDTH=<width>. Work-items stride over whole vectors first, then
+// the last size % VEC_WIDTH elements are added one by one
+
+#ifndef VEC_WIDTH
+#define VEC_WIDTH 4
+#endif
+
+#define CONCAT(a, b) a##b
+#define EXPAND_CONCAT(a, b) CONCAT(a, b)
+
+#define intN EXPAND_CONCAT(int, VEC_WIDTH)
+#define vloadN EXPAND_CONCAT(vload, VEC_WIDTH)
+#define vstoreN EXPAND_CONCAT(vstore, VEC_WIDTH)
+
+__kernel void vec_add_vec(__global int *A, __global int *B,
+                                          __global int *C, int size)
+{
+  size_t max_id = get_global_size(0);
+  size_t vectors = size / VEC_WIDTH;
+  size_t i = get_global_id(0);
+
+  while(i < vectors)
+  {
+    intN a = vloadN(i, A);
+    intN b = vloadN(i, B);
+    vstoreN(a + b, i, C);
+
+    i += max_id;
+  }
+
+  i = vectors * VEC_WIDTH + get_global_id(0);
+
+  while(i < size)
+  {
+    C[i] = A[i] + B[i];
+
+    i += max_id;
+  }
+}
+
+
+
+// Many small vec_adds in one launch, the layout ocl2::Batcher launches.
+// Work-group g adds slice g: slices[g] holds the offsets of the slice in A,
+// B and C and its size
+__kernel void vec_add_batched(__global const uint4 *slices, uint num_slices,
+                              __global int *A, __global int *B,
+                              __global int *C)
+{
+  const size_t g = get_group_id(0);
+  if(g >= num_slices)
+    return;
+
+  const uint4 slice = slices[g];
+
+  for(size_t i = get_local_id(0); i < slice.s3; i += get_local_size(0))
+    C[slice.s2 + i] = A[slice.s0 + i] + B[slice.s1 + i];
+}
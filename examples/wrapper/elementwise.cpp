@@ -0,0 +1,158 @@
+//-----------------------------------------------------------------------------
+//
+// Fused elementwise expressions, no kernel file needed
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "ocl2.hpp"
+
+namespace
+{
+
+enum { VEC_SIZE = 1048576 };
+
+struct config_t
+{
+  cl_device_type type = CL_DEVICE_TYPE_GPU;
+  bool be_verbose = false;
+  size_t size = VEC_SIZE;
+};
+
+config_t configurate(int argc, const char **argv)
+{
+  config_t config;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    if((std::strcmp(argv[i], "-v") == 0) ||
+                                      (std::strcmp(argv[i], "--verbose") == 0))
+    {
+      config.be_verbose = true;
+    }
+    else if(std::strncmp(argv[i], "--size=", 7) == 0)
+    {
+      config.size = std::strtoull(argv[i] + 7, nullptr, 10);
+    }
+    else if(std::strcmp(argv[i], "--device=GPU") == 0)
+    {
+      config.type = CL_DEVICE_TYPE_GPU;
+    }
+    else if(std::strcmp(argv[i], "--device=CPU") == 0)
+    {
+      config.type = CL_DEVICE_TYPE_CPU;
+    }
+    else
+    {
+      std::cerr << "Fatal error: unrecognized command line option '"
+                                                         << argv[i] << "'\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  return config;
+}
+
+double kernel_seconds(const ocl2::Event &event)
+{
+  return (event.profiling(CL_PROFILING_COMMAND_END) -
+                       event.profiling(CL_PROFILING_COMMAND_START)) * 1e-9;
+}
+
+} // namespace
+
+
+
+int main(int argc, const char **argv) try
+{
+  std::cout << "Running elementwise...\n";
+
+  const config_t config = configurate(argc, argv);
+  const size_t size = config.size;
+
+  ocl2::Context context(ocl2::select_device(
+                                      ocl2::DeviceFilter().type(config.type)));
+  ocl2::Queue queue(context, CL_QUEUE_PROFILING_ENABLE);
+
+  if(config.be_verbose)
+    std::cout << "Target device : " << context.device().name() << "\n";
+
+  std::vector<cl_float> A(size), B(size), C(size);
+  for(size_t i = 0; i < size; ++i)
+  {
+    A[i] = cl_float(i % 1000);
+    B[i] = cl_float(i % 7);
+  }
+
+  ocl2::Buffer<cl_float> A_buffer(context, size, CL_MEM_READ_ONLY);
+  ocl2::Buffer<cl_float> B_buffer(context, size, CL_MEM_READ_ONLY);
+  ocl2::Buffer<cl_float> C_buffer(context, size);
+  ocl2::Buffer<cl_float> temp(context, size);
+  queue.write(A_buffer, A.data());
+  queue.write(B_buffer, B.data());
+
+  // One operation per pass, every pass reads and writes all of memory
+  const ocl2::Event square = ocl2::assign(context, queue, temp,
+                                                       A_buffer * A_buffer);
+  const ocl2::Event add = ocl2::assign(context, queue, temp, temp + B_buffer,
+                                                                      square);
+  const ocl2::Event scale = ocl2::assign(context, queue, C_buffer,
+                                                          temp * 0.5f, add);
+  scale.wait();
+
+  const double separate = kernel_seconds(square) + kernel_seconds(add) +
+                                                       kernel_seconds(scale);
+
+  // The same expression generated as a single kernel
+  const ocl2::Event fused = ocl2::assign(context, queue, C_buffer,
+                                     (A_buffer * A_buffer + B_buffer) * 0.5f);
+  fused.wait();
+
+  if(config.be_verbose)
+  {
+    std::cout << "Separate passes : " << separate << "s\n"
+              << "Fused kernel : " << kernel_seconds(fused) << "s\n";
+  }
+
+  queue.read(C_buffer, C.data());
+
+  int errors = 0;
+
+  for(size_t i = 0; i < size; ++i)
+  {
+    const cl_float expected = (A[i] * A[i] + B[i]) * 0.5f;
+    if(std::fabs(C[i] - expected) > 1e-3f * std::fabs(expected))
+    {
+      std::cout << C[i] << " != " << expected << " with i == " << i << "\n";
+      ++errors;
+    }
+  }
+
+  if(errors != 0)
+  {
+    std::cout << "Error: " << errors << " errors in evaluation found!\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Evaluated correctly!\n";
+  return EXIT_SUCCESS;
+}
+catch(const std::exception &e)
+{
+  std::cerr << "Error: " << e.what() << "\n";
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,348 @@
+//-----------------------------------------------------------------------------
+//
+// Matrix multiplication with the C++ wrapper
+//
+// A[n x m] * B[m x k] = C[n x k]
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ocl2.hpp"
+#include "matrix_mult_kernel.h"
+
+namespace
+{
+
+enum { N = 2024, M = 2024, K = 2024 };
+
+enum class variant_t { naive, tiled, blocked };
+
+const char *variant_kernel_name(variant_t variant)
+{
+  switch(variant)
+  {
+  case variant_t::naive:
+    return "matrix_mult_naive";
+  case variant_t::tiled:
+    return "matrix_mult_tiled";
+  case variant_t::blocked:
+    return "matrix_mult_blocked";
+  }
+
+  return nullptr;
+}
+
+struct config_t
+{
+  cl_device_type type = CL_DEVICE_TYPE_GPU;
+  bool be_verbose = false;
+  bool with_timing = false;
+  bool use_cache = true;
+  bool tune = false;
+  // Replaces the embedded kernels when set
+  const char *kernel_filename = nullptr;
+  variant_t variant = variant_t::blocked;
+  int tile_size = 16;
+  int work_per_thread = 4;
+};
+
+[[noreturn]] void fail(const std::string &message)
+{
+  std::cerr << "Fatal error: " << message << "\n";
+  std::exit(EXIT_FAILURE);
+}
+
+config_t configurate(int argc, const char **argv)
+{
+  config_t config;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if(arg == "-v" || arg == "--verbose")
+      config.be_verbose = true;
+    else if(arg == "-wt" || arg == "--with-timing")
+      config.with_timing = true;
+    else if(arg == "--no-cache")
+      config.use_cache = false;
+    else if(arg == "--tune")
+      config.tune = true;
+    else if(arg == "-k")
+    {
+      if(i + 1 == argc)
+        fail("missing filename after '-k'");
+      config.kernel_filename = argv[++i];
+    }
+    else if(arg == "--variant=naive")
+      config.variant = variant_t::naive;
+    else if(arg == "--variant=tiled")
+      config.variant = variant_t::tiled;
+    else if(arg == "--variant=blocked")
+      config.variant = variant_t::blocked;
+    else if(arg.compare(0, 7, "--tile=") == 0)
+      config.tile_size = std::atoi(argv[i] + 7);
+    else if(arg.compare(0, 6, "--wpt=") == 0)
+      config.work_per_thread = std::atoi(argv[i] + 6);
+    else if(arg == "--device=GPU")
+      config.type = CL_DEVICE_TYPE_GPU;
+    else if(arg == "--device=CPU")
+      config.type = CL_DEVICE_TYPE_CPU;
+    else
+      fail("unrecognized command line option '" + arg + "'");
+  }
+
+  if(config.tile_size <= 0 || config.work_per_thread <= 0 ||
+                                 config.tile_size % config.work_per_thread != 0)
+  {
+    fail("tile size must be divisible by work per thread");
+  }
+
+  return config;
+}
+
+size_t round_up(size_t value, size_t multiple)
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Local size each variant needs for its tile parameters, naive one leaves
+// it to the runtime
+std::vector<size_t> variant_local(variant_t variant, long ts, long wpt)
+{
+  switch(variant)
+  {
+  case variant_t::naive:
+    return {};
+  case variant_t::tiled:
+    return { size_t(ts), size_t(ts) };
+  case variant_t::blocked:
+    return { size_t(ts), size_t(ts / wpt) };
+  }
+
+  return {};
+}
+
+std::vector<size_t> variant_global(variant_t variant,
+                                   const ocl2::TuneConfig &params,
+                                                           size_t n, size_t k)
+{
+  const size_t ts = params.define("TILE_SIZE");
+  const size_t wpt = params.define("WPT");
+
+  switch(variant)
+  {
+  case variant_t::naive:
+    return { n, k };
+  case variant_t::tiled:
+    return { k, n };
+  case variant_t::blocked:
+    return { k, round_up(n, ts) / wpt };
+  }
+
+  return {};
+}
+
+// Searches tile parameters and local sizes on the first run for this
+// device and shape, later runs read the stored result
+ocl2::TuneConfig tune(const ocl2::Context &context, const std::string &source,
+                      variant_t variant, const ocl2::Buffer<cl_int> &A,
+                      const ocl2::Buffer<cl_int> &B, ocl2::Buffer<cl_int> &C,
+                                                  cl_int n, cl_int m, cl_int k)
+{
+  ocl2::TuneSpace space;
+
+  if(variant == variant_t::naive)
+  {
+    space.defines = { { "TILE_SIZE", { 16 } }, { "WPT", { 1 } } };
+    space.dims = 2;
+  }
+  else
+  {
+    space.defines = { { "TILE_SIZE", { 8, 16, 32 } },
+                      { "WPT", variant == variant_t::tiled ?
+                                   std::vector<long>{ 1 } :
+                                   std::vector<long>{ 1, 2, 4, 8 } } };
+    space.valid = [](const ocl2::TuneConfig &params)
+    {
+      return params.define("TILE_SIZE") % params.define("WPT") == 0;
+    };
+    space.local_for = [variant](const ocl2::TuneConfig &params)
+    {
+      return variant_local(variant, params.define("TILE_SIZE"),
+                                                   params.define("WPT"));
+    };
+  }
+
+  ocl2::Tuner tuner(context);
+  const std::string shape = std::to_string(n) + "x" + std::to_string(m) +
+                                                     "x" + std::to_string(k);
+
+  return tuner.tune(source, variant_kernel_name(variant), shape, space,
+      [&](ocl2::Queue &queue, ocl2::Kernel &kernel,
+                                          const ocl2::TuneConfig &params)
+      {
+        return kernel(queue, params.range(variant_global(variant, params,
+                                                                    n, k)),
+                      A, B, C, n, m, k);
+      });
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                                start).count();
+}
+
+} // namespace
+
+
+
+int main(int argc, const char **argv) try
+{
+  std::cout << "Running matrix_mult...\n";
+
+  const config_t config = configurate(argc, argv);
+
+  ocl2::Context context(ocl2::select_device(
+                                      ocl2::DeviceFilter().type(config.type)));
+  ocl2::Profiler profiler;
+  ocl2::Queue queue = config.with_timing ? ocl2::Queue(context, profiler) :
+                                           ocl2::Queue(context);
+
+  if(config.be_verbose)
+    std::cout << "Target device : " << context.device().name() << "\n";
+
+  const cl_int n = N, m = M, k = K;
+  const std::string source = config.kernel_filename != nullptr ?
+                              ocl2::read_file(config.kernel_filename) :
+                              std::string(matrix_mult_kernel_source,
+                                           matrix_mult_kernel_source_size);
+
+  ocl2::Buffer<cl_int> buffer_A(context, size_t(n) * m, CL_MEM_READ_ONLY);
+  ocl2::Buffer<cl_int> buffer_B(context, size_t(m) * k, CL_MEM_READ_ONLY);
+  ocl2::Buffer<cl_int> buffer_C(context, size_t(n) * k, CL_MEM_WRITE_ONLY);
+
+  ocl2::TuneConfig params;
+  if(config.tune)
+  {
+    params = tune(context, source, config.variant, buffer_A, buffer_B,
+                                                       buffer_C, n, m, k);
+  }
+  else
+  {
+    params.defines = { { "TILE_SIZE", config.tile_size },
+                       { "WPT", config.work_per_thread } };
+    params.local = variant_local(config.variant, config.tile_size,
+                                                     config.work_per_thread);
+  }
+
+  const std::string options = params.options();
+  const ocl2::NDRange range = params.range(variant_global(config.variant,
+                                                             params, n, k));
+
+  if(config.be_verbose)
+  {
+    std::cout << "Build options : " << options << "\n"
+              << "Local size : " << (range.local() == nullptr ? "auto" :
+                    std::to_string(range.local()[0]) + "x" +
+                    std::to_string(range.local()[1])) << "\n";
+  }
+
+  ocl2::Program program = config.use_cache ?
+                      ocl2::Program::build_cached(context, source, options) :
+                      ocl2::Program::from_source(context, source);
+  if(!config.use_cache)
+    program.build(options);
+
+  ocl2::Kernel kernel(program, variant_kernel_name(config.variant));
+
+  std::vector<cl_int> A(n * m), B(m * k), C(n * k), C_CPU(n * k);
+
+  for(cl_int i = 0; i < n; ++i)
+    for(cl_int j = 0; j < m; ++j)
+      A[i * m + j] = i + j;
+
+  for(cl_int i = 0; i < m; ++i)
+    for(cl_int j = 0; j < k; ++j)
+      B[i * k + j] = (i * j) % (3 * (m + k));
+
+  // The whole upload/compute/download graph is submitted before the CPU
+  // reference is calculated, so both run at the same time unless timing
+  // is requested
+  auto start = std::chrono::steady_clock::now();
+
+  ocl2::Event upload_A = queue.enqueue_write(buffer_A, A.data());
+  ocl2::Event upload_B = queue.enqueue_write(buffer_B, B.data());
+  ocl2::Event computed = kernel.enqueue(queue, range, { upload_A, upload_B },
+                                   buffer_A, buffer_B, buffer_C, n, m, k);
+  ocl2::Event downloaded = queue.enqueue_read(buffer_C, C.data(), computed);
+  queue.flush();
+
+  if(config.with_timing)
+  {
+    downloaded.wait();
+    std::cout << "Target device wall time: " << seconds_since(start) << "s\n";
+
+    profiler.annotate(computed, 2.0 * n * m * k,
+                                       sizeof(cl_int) * (A.size() + B.size() +
+                                                                  C.size()));
+    profiler.report(std::cout);
+  }
+
+  start = std::chrono::steady_clock::now();
+  ocl2::host::matrix_mult(A.data(), B.data(), C_CPU.data(), n, m, k);
+  if(config.with_timing)
+  {
+    std::cout << "CPU calculating time (" << ocl2::host::threads() <<
+                       " threads): " << seconds_since(start) << "s\n";
+  }
+
+  downloaded.wait();
+
+  // Stops looking once there are more errors than get printed
+  const std::vector<size_t> errors = ocl2::host::compare(C.data(),
+                                              C_CPU.data(), C.size(), 21);
+
+  for(size_t i : errors)
+  {
+    std::cout << "incorrect: C[" << i / k << ":" << i % k << "] == " << C[i]
+                                            << " != " << C_CPU[i] << "\n";
+  }
+
+  if(errors.size() > 20)
+  {
+    std::cout << "Too many errors...\n";
+    return EXIT_FAILURE;
+  }
+
+  if(!errors.empty())
+  {
+    std::cout << "Error: " << errors.size() <<
+                                   " errors in multiplication found!\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Multiplied correctly!\n";
+  return EXIT_SUCCESS;
+}
+catch(const std::exception &e)
+{
+  std::cerr << "Error: " << e.what() << "\n";
+  return EXIT_FAILURE;
+}
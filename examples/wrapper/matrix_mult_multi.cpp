@@ -0,0 +1,227 @@
+//-----------------------------------------------------------------------------
+//
+// Matrix multiplication split by rows across all devices
+//
+// A[n x m] * B[m x k] = C[n x k]
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ocl2.hpp"
+#include "matrix_mult_kernel.h"
+
+namespace
+{
+
+enum { N = 2024, M = 2024, K = 2024 };
+
+struct config_t
+{
+  cl_device_type type = CL_DEVICE_TYPE_ALL;
+  bool be_verbose = false;
+  // Replaces the embedded kernels when set
+  const char *kernel_filename = nullptr;
+  int runs = 5;
+  int tile_size = 16;
+  int work_per_thread = 4;
+};
+
+[[noreturn]] void fail(const std::string &message)
+{
+  std::cerr << "Fatal error: " << message << "\n";
+  std::exit(EXIT_FAILURE);
+}
+
+config_t configurate(int argc, const char **argv)
+{
+  config_t config;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if(arg == "-v" || arg == "--verbose")
+      config.be_verbose = true;
+    else if(arg == "-k")
+    {
+      if(i + 1 == argc)
+        fail("missing filename after '-k'");
+      config.kernel_filename = argv[++i];
+    }
+    else if(arg.compare(0, 7, "--runs=") == 0)
+      config.runs = std::atoi(argv[i] + 7);
+    else if(arg.compare(0, 7, "--tile=") == 0)
+      config.tile_size = std::atoi(argv[i] + 7);
+    else if(arg.compare(0, 6, "--wpt=") == 0)
+      config.work_per_thread = std::atoi(argv[i] + 6);
+    else if(arg == "--device=GPU")
+      config.type = CL_DEVICE_TYPE_GPU;
+    else if(arg == "--device=CPU")
+      config.type = CL_DEVICE_TYPE_CPU;
+    else if(arg == "--device=ALL")
+      config.type = CL_DEVICE_TYPE_ALL;
+    else
+      fail("unrecognized command line option '" + arg + "'");
+  }
+
+  if(config.tile_size <= 0 || config.work_per_thread <= 0 ||
+                                 config.tile_size % config.work_per_thread != 0)
+  {
+    fail("tile size must be divisible by work per thread");
+  }
+
+  if(config.runs <= 0)
+    fail("number of runs must be positive");
+
+  return config;
+}
+
+size_t round_up(size_t value, size_t multiple)
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Kernel and buffers of one device, A and C hold the rows of its share at
+// their beginning
+struct part_t
+{
+  part_t(const ocl2::Context &context, const std::string &source,
+         const std::string &options, size_t n, size_t m, size_t k)
+    : program(ocl2::Program::build_cached(context, source, options)),
+      kernel(program, "matrix_mult_blocked"),
+      A(context, n * m, CL_MEM_READ_ONLY), B(context, m * k, CL_MEM_READ_ONLY),
+      C(context, n * k, CL_MEM_WRITE_ONLY)
+  {
+  }
+
+  ocl2::Program program;
+  ocl2::Kernel kernel;
+  ocl2::Buffer<cl_int> A, B, C;
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                                start).count();
+}
+
+} // namespace
+
+
+
+int main(int argc, const char **argv) try
+{
+  std::cout << "Running matrix_mult_multi...\n";
+
+  const config_t config = configurate(argc, argv);
+
+  ocl2::MultiDevice devices(config.type);
+
+  const cl_int n = N, m = M, k = K;
+  const size_t ts = config.tile_size, wpt = config.work_per_thread;
+  const std::string source = config.kernel_filename != nullptr ?
+                              ocl2::read_file(config.kernel_filename) :
+                              std::string(matrix_mult_kernel_source,
+                                           matrix_mult_kernel_source_size);
+  const std::string options = "-DTILE_SIZE=" + std::to_string(ts) +
+                              " -DWPT=" + std::to_string(wpt);
+
+  std::vector<cl_int> A(n * m), B(m * k), C(n * k), C_CPU(n * k);
+
+  for(cl_int i = 0; i < n; ++i)
+    for(cl_int j = 0; j < m; ++j)
+      A[i * m + j] = i + j;
+
+  for(cl_int i = 0; i < m; ++i)
+    for(cl_int j = 0; j < k; ++j)
+      B[i * k + j] = (i * j) % (3 * (m + k));
+
+  // Every device can get any number of rows, so all of them get room for
+  // all of A and C
+  std::vector<part_t> parts;
+  parts.reserve(devices.size());
+  for(size_t i = 0; i < devices.size(); ++i)
+  {
+    if(config.be_verbose)
+      std::cout << "Device " << i << " : " << devices.device(i).name() << "\n";
+
+    parts.emplace_back(devices.context(i), source, options, n, m, k);
+    devices.queue(i).write(parts.back().B, B.data());
+  }
+
+  // Shares are whole tiles of rows. Later runs move rows to the devices
+  // that finished first
+  for(int run = 0; run < config.runs; ++run)
+  {
+    const auto start = std::chrono::steady_clock::now();
+
+    const std::vector<ocl2::Share> shares = devices.run(n, ts,
+        [&](const ocl2::Share &share)
+        {
+          ocl2::Queue &queue = devices.queue(share.device);
+          part_t &part = parts[share.device];
+          const cl_int rows = cl_int(share.count);
+
+          ocl2::Event upload = queue.enqueue_write(part.A,
+                            A.data() + share.offset * m, 0, share.count * m);
+          ocl2::Event computed = part.kernel.enqueue(queue,
+                  ocl2::NDRange({ round_up(k, ts), round_up(rows, ts) / wpt },
+                                { ts, ts / wpt }),
+                  upload, part.A, part.B, part.C, rows, m, k);
+          return queue.enqueue_read(part.C, C.data() + share.offset * k, 0,
+                                              share.count * k, computed);
+        });
+
+    std::cout << "Run " << run << " : " << seconds_since(start) << "s, rows";
+    for(const ocl2::Share &share : shares)
+      std::cout << " " << share.count << " on device " << share.device;
+    std::cout << "\n";
+  }
+
+  ocl2::host::matrix_mult(A.data(), B.data(), C_CPU.data(), n, m, k);
+
+  // Stops looking once there are more errors than get printed
+  const std::vector<size_t> errors = ocl2::host::compare(C.data(),
+                                              C_CPU.data(), C.size(), 21);
+
+  for(size_t i : errors)
+  {
+    std::cout << "incorrect: C[" << i / k << ":" << i % k << "] == " << C[i]
+                                            << " != " << C_CPU[i] << "\n";
+  }
+
+  if(errors.size() > 20)
+  {
+    std::cout << "Too many errors...\n";
+    return EXIT_FAILURE;
+  }
+
+  if(!errors.empty())
+  {
+    std::cout << "Error: " << errors.size() <<
+                                   " errors in multiplication found!\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Multiplied correctly!\n";
+  return EXIT_SUCCESS;
+}
+catch(const std::exception &e)
+{
+  std::cerr << "Error: " << e.what() << "\n";
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,225 @@
+//-----------------------------------------------------------------------------
+//
+// Multiplying matrices subdivided on the device with device-side enqueue
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ocl2.hpp"
+#include "matrix_mult_recursive_kernel.h"
+
+namespace
+{
+
+enum { N = 1024, M = 1024, K = 1024 };
+
+struct config_t
+{
+  cl_device_type type = CL_DEVICE_TYPE_GPU;
+  bool be_verbose = false;
+  bool with_timing = false;
+  bool use_cache = true;
+  // Replaces the embedded kernels when set
+  const char *kernel_filename = nullptr;
+  cl_int size = N;
+  cl_int leaf = 64;
+};
+
+[[noreturn]] void fail(const std::string &message)
+{
+  std::cerr << "Fatal error: " << message << "\n";
+  std::exit(EXIT_FAILURE);
+}
+
+config_t configurate(int argc, const char **argv)
+{
+  config_t config;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+
+    if(arg == "-v" || arg == "--verbose")
+      config.be_verbose = true;
+    else if(arg == "-wt" || arg == "--with-timing")
+      config.with_timing = true;
+    else if(arg == "--no-cache")
+      config.use_cache = false;
+    else if(arg == "-k")
+    {
+      if(i + 1 == argc)
+        fail("missing filename after '-k'");
+      config.kernel_filename = argv[++i];
+    }
+    else if(arg.compare(0, 7, "--size=") == 0)
+      config.size = std::atoi(argv[i] + 7);
+    else if(arg.compare(0, 7, "--leaf=") == 0)
+      config.leaf = std::atoi(argv[i] + 7);
+    else if(arg == "--device=GPU")
+      config.type = CL_DEVICE_TYPE_GPU;
+    else if(arg == "--device=CPU")
+      config.type = CL_DEVICE_TYPE_CPU;
+    else
+      fail("unrecognized command line option '" + arg + "'");
+  }
+
+  if(config.size <= 0 || config.leaf <= 0)
+    fail("size and leaf must be positive");
+
+  return config;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                                start).count();
+}
+
+} // namespace
+
+
+
+int main(int argc, const char **argv) try
+{
+  std::cout << "Running matrix_mult_recursive...\n";
+
+  const config_t config = configurate(argc, argv);
+
+  ocl2::Context context(ocl2::select_device(
+                                      ocl2::DeviceFilter().type(config.type)));
+  ocl2::Queue queue(context);
+
+  if(config.be_verbose)
+    std::cout << "Target device : " << context.device().name() << "\n";
+
+  if(!ocl2::DeviceQueue::supported(context.device()))
+  {
+    std::cout << "Error: " << context.device().name()
+              << " has no device-side enqueue\n";
+    return EXIT_FAILURE;
+  }
+
+  // Every block waiting to be split or multiplied takes room in the device
+  // queue, so it gets as much as the device allows
+  ocl2::DeviceQueue device_queue(context, true,
+                           ocl2::DeviceQueue::max_size(context.device()));
+
+  if(config.be_verbose)
+    std::cout << "Device queue : " << device_queue.size() << " bytes\n";
+
+  const std::string file = config.kernel_filename != nullptr ?
+                               ocl2::read_file(config.kernel_filename) : "";
+  const ocl2::ProgramSource source = config.kernel_filename != nullptr ?
+                              ocl2::ProgramSource{ file.data(), file.size() } :
+                              OCL2_EMBEDDED(matrix_mult_recursive_kernel);
+  ocl2::Program program = ocl2::Program::build_from(context, source,
+                                           "-cl-std=CL2.0", config.use_cache);
+
+  ocl2::Kernel kernel(program, "matrix_mult_recursive");
+
+  const cl_int n = config.size, m = config.size, k = config.size;
+
+  std::vector<cl_int> A(size_t(n) * m), B(size_t(m) * k), C(size_t(n) * k),
+                                                        C_CPU(size_t(n) * k);
+
+  for(cl_int i = 0; i < n; ++i)
+    for(cl_int j = 0; j < m; ++j)
+      A[i * m + j] = i + j;
+
+  for(cl_int i = 0; i < m; ++i)
+    for(cl_int j = 0; j < k; ++j)
+      B[i * k + j] = (i * j) % (3 * (m + k));
+
+  ocl2::Buffer<cl_int> buffer_A(context, A.size(), CL_MEM_READ_ONLY);
+  ocl2::Buffer<cl_int> buffer_B(context, B.size(), CL_MEM_READ_ONLY);
+  ocl2::Buffer<cl_int> buffer_C(context, C.size(), CL_MEM_WRITE_ONLY);
+  ocl2::Buffer<cl_int> failed(context, 1);
+
+  const cl_int no_failures = 0;
+  cl_int failures = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  ocl2::Event upload_A = queue.enqueue_write(buffer_A, A.data());
+  ocl2::Event upload_B = queue.enqueue_write(buffer_B, B.data());
+  ocl2::Event cleared = queue.enqueue_write(failed, &no_failures);
+
+  // One work-item, the device does the rest. The event completes when the
+  // last block is multiplied
+  ocl2::Event computed = kernel.enqueue(queue, 1,
+                                        { upload_A, upload_B, cleared },
+                                        buffer_A, buffer_B, buffer_C, n, m,
+                                        k, config.leaf, failed);
+  ocl2::Event counted = queue.enqueue_read(failed, &failures, computed);
+  ocl2::Event downloaded = queue.enqueue_read(buffer_C, C.data(), computed);
+  queue.flush();
+
+  if(config.with_timing)
+  {
+    downloaded.wait();
+    std::cout << "Target device wall time: " << seconds_since(start) << "s\n";
+  }
+
+  start = std::chrono::steady_clock::now();
+  ocl2::host::matrix_mult(A.data(), B.data(), C_CPU.data(), n, m, k);
+  if(config.with_timing)
+  {
+    std::cout << "CPU calculating time (" << ocl2::host::threads() <<
+                       " threads): " << seconds_since(start) << "s\n";
+  }
+
+  counted.wait();
+  downloaded.wait();
+
+  if(failures != 0)
+  {
+    std::cout << "Error: " << failures << " child kernels could not be "
+              << "enqueued, the device queue is full. Try a larger --leaf\n";
+    return EXIT_FAILURE;
+  }
+
+  // Stops looking once there are more errors than get printed
+  const std::vector<size_t> errors = ocl2::host::compare(C.data(),
+                                              C_CPU.data(), C.size(), 21);
+
+  for(size_t i : errors)
+  {
+    std::cout << "incorrect: C[" << i / k << ":" << i % k << "] == " << C[i]
+                                            << " != " << C_CPU[i] << "\n";
+  }
+
+  if(errors.size() > 20)
+  {
+    std::cout << "Too many errors...\n";
+    return EXIT_FAILURE;
+  }
+
+  if(!errors.empty())
+  {
+    std::cout << "Error: " << errors.size() <<
+                                   " errors in multiplication found!\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Multiplied correctly!\n";
+  return EXIT_SUCCESS;
+}
+catch(const std::exception &e)
+{
+  std::cerr << "Error: " << e.what() << "\n";
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,263 @@
+//-----------------------------------------------------------------------------
+//
+// Adding vectors with the C++ wrapper
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "ocl2.hpp"
+#include "vec_add_kernel.h"
+
+namespace
+{
+
+enum { VEC_SIZE = 1048576 };
+enum { CHUNK_SIZE = 262144 };
+
+struct config_t
+{
+  cl_device_type type = CL_DEVICE_TYPE_GPU;
+  bool be_verbose = false;
+  bool use_cache = true;
+  // Replaces the embedded kernels when set
+  const char *kernel_filename = nullptr;
+  size_t size = VEC_SIZE;
+  size_t chunk_size = CHUNK_SIZE;
+  size_t depth = 3;
+  bool zero_copy = false;
+  // Elements each work-item adds at once, 0 picks the device's width
+  cl_uint vec_width = 0;
+};
+
+config_t configurate(int argc, const char **argv)
+{
+  config_t config;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    if((std::strcmp(argv[i], "-v") == 0) ||
+                                      (std::strcmp(argv[i], "--verbose") == 0))
+    {
+      config.be_verbose = true;
+    }
+    else if(std::strcmp(argv[i], "--no-cache") == 0)
+    {
+      config.use_cache = false;
+    }
+    else if(std::strncmp(argv[i], "--size=", 7) == 0)
+    {
+      config.size = std::strtoull(argv[i] + 7, nullptr, 10);
+    }
+    else if(std::strncmp(argv[i], "--chunk=", 8) == 0)
+    {
+      config.chunk_size = std::strtoull(argv[i] + 8, nullptr, 10);
+    }
+    else if(std::strncmp(argv[i], "--depth=", 8) == 0)
+    {
+      config.depth = std::strtoull(argv[i] + 8, nullptr, 10);
+    }
+    else if(std::strcmp(argv[i], "--zero-copy") == 0)
+    {
+      config.zero_copy = true;
+    }
+    else if(std::strncmp(argv[i], "--vec=", 6) == 0)
+    {
+      config.vec_width = cl_uint(std::strtoul(argv[i] + 6, nullptr, 10));
+      if(config.vec_width > 16 || (config.vec_width & (config.vec_width - 1)))
+      {
+        std::cerr << "Error: vector width must be 0, 1, 2, 4, 8 or 16\n";
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    else if(std::strcmp(argv[i], "-k") == 0)
+    {
+      if(i + 1 == argc)
+      {
+        std::cerr << "Error: missing filename after '-k'\n";
+        std::exit(EXIT_FAILURE);
+      }
+      config.kernel_filename = argv[++i];
+    }
+    else if(std::strcmp(argv[i], "--device=GPU") == 0)
+    {
+      config.type = CL_DEVICE_TYPE_GPU;
+    }
+    else if(std::strcmp(argv[i], "--device=CPU") == 0)
+    {
+      config.type = CL_DEVICE_TYPE_CPU;
+    }
+    else
+    {
+      std::cerr << "Fatal error: unrecognized command line option '"
+                                                         << argv[i] << "'\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  return config;
+}
+
+using VecAdd = ocl2::KernelFunctor<ocl2::Buffer<cl_int>, ocl2::Buffer<cl_int>,
+                                   ocl2::Buffer<cl_int>, cl_int>;
+
+// Work-items needed to cover size elements, vec_width at a time
+size_t vec_items(size_t size, cl_uint vec_width)
+{
+  return std::max<size_t>((size + vec_width - 1) / vec_width, 1);
+}
+
+void init_inputs(cl_int *A, cl_int *B, size_t size)
+{
+  for(size_t i = 0; i < size; ++i)
+  {
+    A[i] = cl_int(i);
+    B[i] = cl_int(size - i);
+  }
+}
+
+// Host arrays are streamed through the device chunk by chunk, so size is
+// not limited by device memory
+void run_streamed(const ocl2::Context &context, VecAdd &vec_add, size_t size,
+                     cl_uint vec_width, cl_int *C, const config_t &config)
+{
+  std::vector<cl_int> A(size), B(size);
+  init_inputs(A.data(), B.data(), size);
+
+  ocl2::StreamExecutor<cl_int> stream(context, 2, 1, config.chunk_size,
+                                                                config.depth);
+
+  const ocl2::StreamStats stats = stream.run({ A.data(), B.data() }, { C },
+                                                                        size,
+      [&](ocl2::Queue &queue, ocl2::StreamChunk<cl_int> &chunk,
+                                                   const ocl2::WaitList &deps)
+      {
+        const ocl2::NDRange range(vec_items(chunk.size, vec_width));
+        return vec_add.enqueue(queue, range, deps,
+                               chunk.inputs[0], chunk.inputs[1],
+                               chunk.outputs[0], cl_int(chunk.size));
+      });
+
+  if(config.be_verbose)
+  {
+    std::cout << "Chunks : " << stats.chunks << " of " << config.chunk_size
+              << " elements, depth " << config.depth << "\n"
+              << "Device span : " << stats.span << "s, transfers "
+              << stats.transfer_time << "s, kernels " << stats.compute_time
+              << "s, overlap " << stats.overlap() << "\n";
+  }
+}
+
+// Inputs are written straight into buffer memory through map views, which
+// costs no copies when the device shares memory with the host
+void run_zero_copy(const ocl2::Context &context, VecAdd &vec_add, size_t size,
+                      cl_uint vec_width, cl_int *C, const config_t &config)
+{
+  ocl2::Queue queue(context);
+  ocl2::HostBuffer<cl_int> A(context, size, CL_MEM_READ_ONLY);
+  ocl2::HostBuffer<cl_int> B(context, size, CL_MEM_READ_ONLY);
+  ocl2::HostBuffer<cl_int> C_buffer(context, size, CL_MEM_WRITE_ONLY);
+
+  if(config.be_verbose)
+  {
+    std::cout << "Zero-copy buffers : " << (A.is_zero_copy() ? "yes" : "no")
+                                                                      << "\n";
+  }
+
+  {
+    ocl2::MappedView<cl_int> A_view = A.map(queue, CL_MAP_WRITE);
+    ocl2::MappedView<cl_int> B_view = B.map(queue, CL_MAP_WRITE);
+    init_inputs(A_view.data(), B_view.data(), size);
+  }
+
+  ocl2::Event done = vec_add(queue,
+                             ocl2::NDRange(vec_items(size, vec_width)),
+                             A, B, C_buffer, cl_int(size));
+
+  ocl2::MappedView<cl_int> C_view = C_buffer.map(queue, CL_MAP_READ, done);
+  std::copy(C_view.begin(), C_view.end(), C);
+}
+
+} // namespace
+
+
+
+int main(int argc, const char **argv) try
+{
+  std::cout << "Running vec_add...\n";
+
+  const config_t config = configurate(argc, argv);
+
+  ocl2::Context context(ocl2::select_device(
+                                      ocl2::DeviceFilter().type(config.type)));
+
+  if(config.be_verbose)
+    std::cout << "Target device : " << context.device().name() << "\n";
+
+  // Width 1 runs the scalar kernel, wider ones vec_add_vec built for it
+  const cl_uint vec_width = config.vec_width != 0 ? config.vec_width :
+                                   context.device().vector_width<cl_int>();
+  const std::string options = vec_width == 1 ? "" :
+                                "-DVEC_WIDTH=" + std::to_string(vec_width);
+
+  if(config.be_verbose)
+    std::cout << "Vector width : " << vec_width << "\n";
+
+  const std::string file = config.kernel_filename != nullptr ?
+                               ocl2::read_file(config.kernel_filename) : "";
+  const ocl2::ProgramSource source = config.kernel_filename != nullptr ?
+                              ocl2::ProgramSource{ file.data(), file.size() } :
+                              OCL2_EMBEDDED(vec_add_kernel);
+  ocl2::Program program = ocl2::Program::build_from(context, source, options,
+                                                           config.use_cache);
+
+  VecAdd vec_add(program, vec_width == 1 ? "vec_add" : "vec_add_vec");
+
+  const size_t size = config.size;
+  std::vector<cl_int> C(size);
+
+  // Device working on host memory in place has nothing to stream
+  if(config.zero_copy || context.device().host_unified_memory())
+    run_zero_copy(context, vec_add, size, vec_width, C.data(), config);
+  else
+    run_streamed(context, vec_add, size, vec_width, C.data(), config);
+
+  int errors = 0;
+
+  for(size_t i = 0; i < size; ++i)
+  {
+    if(C[i] != cl_int(size))
+    {
+      std::cout << C[i] << " != " << i << " + " << size - i
+                                                  << " with i == " << i << "\n";
+      ++errors;
+    }
+  }
+
+  if(errors != 0)
+  {
+    std::cout << "Error: " << errors << " errors in adding found!\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Added correctly!\n";
+  return EXIT_SUCCESS;
+}
+catch(const std::exception &e)
+{
+  std::cerr << "Error: " << e.what() << "\n";
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+//-----------------------------------------------------------------------------
+//
+// Adding vectors kept in shared virtual memory
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "ocl2.hpp"
+#include "vec_add_kernel.h"
+
+namespace
+{
+
+enum { VEC_SIZE = 1048576 };
+
+struct config_t
+{
+  cl_device_type type = CL_DEVICE_TYPE_GPU;
+  bool be_verbose = false;
+  // Replaces the embedded kernels when set
+  const char *kernel_filename = nullptr;
+  size_t size = VEC_SIZE;
+  ocl2::SvmGrain grain = ocl2::SvmGrain::coarse;
+};
+
+config_t configurate(int argc, const char **argv)
+{
+  config_t config;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    if((std::strcmp(argv[i], "-v") == 0) ||
+                                      (std::strcmp(argv[i], "--verbose") == 0))
+    {
+      config.be_verbose = true;
+    }
+    else if(std::strncmp(argv[i], "--size=", 7) == 0)
+    {
+      config.size = std::strtoull(argv[i] + 7, nullptr, 10);
+    }
+    else if(std::strcmp(argv[i], "--fine-grain") == 0)
+    {
+      config.grain = ocl2::SvmGrain::fine;
+    }
+    else if(std::strcmp(argv[i], "-k") == 0)
+    {
+      if(i + 1 == argc)
+      {
+        std::cerr << "Error: missing filename after '-k'\n";
+        std::exit(EXIT_FAILURE);
+      }
+      config.kernel_filename = argv[++i];
+    }
+    else if(std::strcmp(argv[i], "--device=GPU") == 0)
+    {
+      config.type = CL_DEVICE_TYPE_GPU;
+    }
+    else if(std::strcmp(argv[i], "--device=CPU") == 0)
+    {
+      config.type = CL_DEVICE_TYPE_CPU;
+    }
+    else
+    {
+      std::cerr << "Fatal error: unrecognized command line option '"
+                                                         << argv[i] << "'\n";
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  return config;
+}
+
+} // namespace
+
+
+
+int main(int argc, const char **argv) try
+{
+  std::cout << "Running vec_add_svm...\n";
+
+  const config_t config = configurate(argc, argv);
+
+  ocl2::Context context(ocl2::select_device(
+                                      ocl2::DeviceFilter().type(config.type)));
+  ocl2::Queue queue(context);
+
+  if(config.be_verbose)
+    std::cout << "Target device : " << context.device().name() << "\n";
+
+  const std::string file = config.kernel_filename != nullptr ?
+                               ocl2::read_file(config.kernel_filename) : "";
+  ocl2::Program program = ocl2::Program::build_from(context,
+                   config.kernel_filename != nullptr ?
+                       ocl2::ProgramSource{ file.data(), file.size() } :
+                       OCL2_EMBEDDED(vec_add_kernel));
+
+  using Ints = ocl2::SvmPointer<cl_int>;
+  ocl2::KernelFunctor<Ints, Ints, Ints, cl_int> vec_add(program, "vec_add");
+
+  const size_t size = config.size;
+  ocl2::svm_allocator<cl_int> allocator(context, config.grain);
+  ocl2::svm_vector<cl_int> A(allocator), B(allocator), C(allocator);
+
+  // Storage is allocated first and filled by the host only while mapped,
+  // which coarse grain SVM requires and fine grain SVM does not care about
+  A.reserve(size);
+  B.reserve(size);
+  C.reserve(size);
+
+  {
+    ocl2::SvmMapping A_mapping = ocl2::svm_map(queue, A, CL_MAP_WRITE);
+    ocl2::SvmMapping B_mapping = ocl2::svm_map(queue, B, CL_MAP_WRITE);
+    ocl2::SvmMapping C_mapping = ocl2::svm_map(queue, C, CL_MAP_WRITE);
+
+    for(size_t i = 0; i < size; ++i)
+    {
+      A.push_back(cl_int(i));
+      B.push_back(cl_int(size - i));
+    }
+    C.resize(size);
+  }
+
+  ocl2::Event done = vec_add(queue, ocl2::NDRange(size), A, B, C,
+                                                                 cl_int(size));
+
+  int errors = 0;
+
+  {
+    ocl2::SvmMapping C_mapping = ocl2::svm_map(queue, C, CL_MAP_READ, done);
+
+    for(size_t i = 0; i < size; ++i)
+    {
+      if(C[i] != cl_int(size))
+      {
+        std::cout << C[i] << " != " << i << " + " << size - i
+                                                << " with i == " << i << "\n";
+        ++errors;
+      }
+    }
+  }
+
+  // clSVMFree does not wait for the unmap still in the queue
+  queue.finish();
+
+  if(errors != 0)
+  {
+    std::cout << "Error: " << errors << " errors in adding found!\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Added correctly!\n";
+  return EXIT_SUCCESS;
+}
+catch(const std::exception &e)
+{
+  std::cerr << "Error: " << e.what() << "\n";
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,43 @@
+//-----------------------------------------------------------------------------
+//
+// C++ wrapper around OpenCL 2
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "ocl2/algorithm.hpp"
+#include "ocl2/batch.hpp"
+#include "ocl2/buffer.hpp"
+#include "ocl2/context.hpp"
+#include "ocl2/device.hpp"
+#include "ocl2/device_info.hpp"
+#include "ocl2/device_queue.hpp"
+#include "ocl2/error.hpp"
+#include "ocl2/event.hpp"
+#include "ocl2/expr.hpp"
+#include "ocl2/host_buffer.hpp"
+#include "ocl2/host_reference.hpp"
+#include "ocl2/kernel.hpp"
+#include "ocl2/multi_device.hpp"
+#include "ocl2/ndrange.hpp"
+#include "ocl2/pool.hpp"
+#include "ocl2/profiler.hpp"
+#include "ocl2/program.hpp"
+#include "ocl2/queue.hpp"
+#include "ocl2/reduce.hpp"
+#include "ocl2/scheduler.hpp"
+#include "ocl2/stream.hpp"
+#include "ocl2/submitter.hpp"
+#include "ocl2/svm.hpp"
+#include "ocl2/trace.hpp"
+#include "ocl2/tuner.hpp"
@@ -0,0 +1,283 @@
+//-----------------------------------------------------------------------------
+//
+// Parallel scan, stream compaction and radix sort of buffers
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "ocl2/reduce.hpp"
+
+namespace ocl2
+{
+namespace detail
+{
+
+// Elements each work-item of the scan and sort kernels takes, and the
+// digit width of one sort pass
+enum { SCAN_ITEMS = 4, RADIX_ITEMS = 8, RADIX_BITS = 4 };
+
+// Kernels ocl2_scan_blocks, scanning tiles of SCAN_ITEMS per work-item
+// and storing the tile totals, and ocl2_scan_add, adding scanned totals
+std::string scan_source(const ReduceType &type, const ReduceOp &op);
+
+// Kernels ocl2_copy_if_flags and ocl2_copy_if_scatter
+std::string copy_if_source(const char *type, bool fp64,
+                                               const std::string &predicate);
+
+// Kernels ocl2_radix_histogram and ocl2_radix_scatter, value_type is null
+// when only keys are sorted
+std::string radix_source(const char *key_type, const char *key_bits,
+                                        const char *value_type, bool fp64);
+
+// Unsigned bits of key k ordered the same way as the keys
+template <typename K>
+struct RadixKey;
+
+template <>
+struct RadixKey<cl_uint>
+{
+  static constexpr const char *bits = "k";
+};
+
+template <>
+struct RadixKey<cl_int>
+{
+  static constexpr const char *bits = "as_uint(k) ^ 0x80000000u";
+};
+
+// Negative floats have all bits flipped, positive ones the sign bit only
+template <>
+struct RadixKey<cl_float>
+{
+  static constexpr const char *bits =
+                "as_uint(k) ^ ((as_uint(k) >> 31) ? 0xffffffffu : 0x80000000u)";
+};
+
+template <typename T>
+Event scan(const Context &context, Queue &queue, const Buffer<T> &in,
+           Buffer<T> &out, bool inclusive, const ReduceOp &op,
+                                                        const WaitList &deps)
+{
+  if(out.size() != in.size())
+  {
+    throw Error(CL_INVALID_VALUE, "scan of " + std::to_string(in.size()) +
+                " elements into " + std::to_string(out.size()));
+  }
+
+  const size_t size = in.size();
+  if(size == 0)
+    return queue.enqueue_marker(deps);
+
+  const std::string source = scan_source(reduce_type<T>(), op);
+  const std::string options = reduce_options(context.device());
+  GeneratedKernel &blocks = generated_kernel(context, source,
+                                             "ocl2_scan_blocks", options);
+  GeneratedKernel &add = generated_kernel(context, source, "ocl2_scan_add",
+                                                                     options);
+
+  const size_t local = std::min(
+                   generated_local_size(blocks.kernel, context.device()),
+                   generated_local_size(add.kernel, context.device()));
+  const size_t tile = local * SCAN_ITEMS;
+  const size_t groups = (size + tile - 1) / tile;
+  const NDRange range({ groups * local }, { local });
+
+  Buffer<T> sums(context, groups);
+  Event scanned = launch_generated(queue, blocks, range, deps, in, out,
+                 sums, cl_ulong(size), cl_int(inclusive),
+                 LocalMemory<T>((SCAN_ITEMS + 1) * local));
+  if(groups == 1)
+    return scanned;
+
+  // Tile totals become tile offsets, scanned the same way in place
+  const Event offsets = scan(context, queue, sums, sums, false, op, scanned);
+
+  return launch_generated(queue, add, range, offsets, out, sums,
+                                                             cl_ulong(size));
+}
+
+template <typename K, typename V>
+Event radix_sort(const Context &context, Queue &queue, Buffer<K> &keys,
+                                 Buffer<V> *values, const WaitList &deps)
+{
+  static_assert(std::is_same<K, cl_uint>::value ||
+                std::is_same<K, cl_int>::value ||
+                std::is_same<K, cl_float>::value,
+                "radix sort takes cl_uint, cl_int or cl_float keys");
+
+  const size_t size = keys.size();
+  if(values != nullptr && values->size() != size)
+  {
+    throw Error(CL_INVALID_VALUE, std::to_string(size) + " keys and " +
+                std::to_string(values->size()) + " values to sort");
+  }
+
+  if(size <= 1)
+    return queue.enqueue_marker(deps);
+
+  const std::string source = radix_source(TypeName<K>::value,
+                   RadixKey<K>::bits,
+                   values != nullptr ? TypeName<V>::value : nullptr,
+                   values != nullptr && std::is_same<V, cl_double>::value);
+  GeneratedKernel &histogram = generated_kernel(context, source,
+                                                      "ocl2_radix_histogram");
+  GeneratedKernel &scatter = generated_kernel(context, source,
+                                                        "ocl2_radix_scatter");
+
+  const size_t local = std::min(
+                   generated_local_size(histogram.kernel, context.device()),
+                   generated_local_size(scatter.kernel, context.device()));
+  const size_t tile = local * RADIX_ITEMS;
+  const size_t groups = (size + tile - 1) / tile;
+  const NDRange range({ groups * local }, { local });
+  const cl_uint radix = 1u << RADIX_BITS;
+
+  Buffer<K> keys_temp(context, size);
+  std::optional<Buffer<V>> values_temp;
+  if(values != nullptr)
+    values_temp.emplace(context, size);
+
+  // Count of every digit in every tile, digit-major, so its exclusive scan
+  // is where the tile's keys with the digit go
+  Buffer<cl_uint> counts(context, radix * groups);
+
+  Buffer<K> *keys_from = &keys, *keys_to = &keys_temp;
+  Buffer<V> *values_from = values;
+  Buffer<V> *values_to = values_temp ? &*values_temp : nullptr;
+  Event sorted;
+
+  // 32 / RADIX_BITS passes is even, so the keys end up back in keys
+  for(cl_uint shift = 0; shift < 32; shift += RADIX_BITS)
+  {
+    const Event counted = launch_generated(queue, histogram, range,
+                    shift == 0 ? deps : WaitList(sorted), *keys_from, counts,
+                    cl_ulong(size), shift, LocalMemory<cl_uint>(radix));
+
+    const Event offsets = scan(context, queue, counts, counts, false,
+                                                  ReduceOp::sum(), counted);
+
+    const LocalMemory<cl_uint> prefix(radix * local);
+    if(values != nullptr)
+    {
+      sorted = launch_generated(queue, scatter, range, offsets, *keys_from,
+                     *keys_to, *values_from, *values_to, counts,
+                     cl_ulong(size), shift, prefix);
+    }
+    else
+    {
+      sorted = launch_generated(queue, scatter, range, offsets, *keys_from,
+                             *keys_to, counts, cl_ulong(size), shift, prefix);
+    }
+
+    std::swap(keys_from, keys_to);
+    std::swap(values_from, values_to);
+  }
+
+  return sorted;
+}
+
+} // namespace detail
+
+
+
+// out[i] = in[0] op ... op in[i - 1], out[0] is the identity of op. Tiles
+// are scanned by work-groups, with work_group_scan_exclusive_* when the
+// device has them, then the tile totals are scanned the same way and added
+// to the tiles. out may be in
+template <typename T>
+Event exclusive_scan(const Context &context, Queue &queue,
+                     const Buffer<T> &in, Buffer<T> &out,
+                     const ReduceOp &op = ReduceOp::sum(),
+                                                 const WaitList &deps = {})
+{
+  return detail::scan(context, queue, in, out, false, op, deps);
+}
+
+// out[i] = in[0] op ... op in[i]
+template <typename T>
+Event inclusive_scan(const Context &context, Queue &queue,
+                     const Buffer<T> &in, Buffer<T> &out,
+                     const ReduceOp &op = ReduceOp::sum(),
+                                                 const WaitList &deps = {})
+{
+  return detail::scan(context, queue, in, out, true, op, deps);
+}
+
+// Copies the elements x of in for which predicate, an OpenCL C expression
+// of x such as "x > 0", is true to the front of out keeping their order,
+// and stores their number in count[0]. Positions come from an exclusive
+// scan of the predicate, nothing goes through the host
+template <typename T>
+Event copy_if(const Context &context, Queue &queue, const Buffer<T> &in,
+              Buffer<T> &out, Buffer<cl_uint> &count,
+              const std::string &predicate, const WaitList &deps = {})
+{
+  if(out.size() < in.size())
+  {
+    throw Error(CL_INVALID_VALUE, "copy_if of " + std::to_string(in.size()) +
+                " elements into " + std::to_string(out.size()));
+  }
+
+  const size_t size = in.size();
+  const std::string source = detail::copy_if_source(
+                                 detail::TypeName<T>::value,
+                                 std::is_same<T, cl_double>::value, predicate);
+  detail::GeneratedKernel &scatter = detail::generated_kernel(context, source,
+                                                      "ocl2_copy_if_scatter");
+
+  // Only stores the zero count
+  if(size == 0)
+  {
+    return detail::launch_generated(queue, scatter, NDRange(1), deps, in, out,
+                                            count, count, cl_ulong(0));
+  }
+
+  detail::GeneratedKernel &flags = detail::generated_kernel(context, source,
+                                                        "ocl2_copy_if_flags");
+
+  Buffer<cl_uint> positions(context, size);
+  const Event flagged = detail::launch_generated(queue, flags, NDRange(size),
+                                      deps, in, positions, cl_ulong(size));
+  const Event scanned = exclusive_scan(context, queue, positions, positions,
+                                               ReduceOp::sum(), flagged);
+
+  return detail::launch_generated(queue, scatter, NDRange(size), scanned, in,
+                                  out, positions, count, cl_ulong(size));
+}
+
+// Ascending LSD radix sort of 32-bit keys, RADIX_BITS per pass. Every pass
+// counts the digits of each tile, scans the counts into global positions
+// and scatters the tiles stably
+template <typename K>
+Event sort(const Context &context, Queue &queue, Buffer<K> &keys,
+                                                   const WaitList &deps = {})
+{
+  return detail::radix_sort<K, K>(context, queue, keys, nullptr, deps);
+}
+
+// Sorts keys and moves values along with them, equal keys keep the order
+// of their values
+template <typename K, typename V>
+Event sort_by_key(const Context &context, Queue &queue, Buffer<K> &keys,
+                               Buffer<V> &values, const WaitList &deps = {})
+{
+  return detail::radix_sort(context, queue, keys, &values, deps);
+}
+
+} // namespace ocl2
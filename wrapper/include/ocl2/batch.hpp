@@ -0,0 +1,143 @@
+//-----------------------------------------------------------------------------
+//
+// Coalescing of many small launches of one kernel into one launch
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ocl2/kernel.hpp"
+
+namespace ocl2
+{
+
+// One small launch: element offsets into up to three buffer arguments and
+// the number of elements, read by the kernel as a uint4
+struct alignas(16) BatchSlice
+{
+  cl_uint offsets[3] = { 0, 0, 0 };
+  cl_uint count = 0;
+};
+
+struct BatchConfig
+{
+  // Slices of one launch, a full batch is launched at once
+  size_t max_batch = 256;
+
+  // Longest a slice waits for others to join its batch, the latency bound
+  // of every slice. Zero launches every slice alone
+  std::chrono::microseconds max_delay{ 200 };
+
+  // Work-items of the work-group handling one slice
+  size_t local_size = 64;
+};
+
+// Collects slices submitted for one kernel and launches them together. The
+// kernel takes (__global const uint4 *slices, uint num_slices, args...),
+// work-group g handles slices[g], and args are the same for all slices,
+// see vec_add_batched. A batch is launched once it is full or its oldest
+// slice has waited max_delay, whichever comes first
+class Batcher
+{
+public:
+  Batcher(const Context &context, const Program &program,
+          const std::string &name, const BatchConfig &config = {});
+
+  // Launches the pending slices and stops the timer
+  ~Batcher();
+
+  Batcher(const Batcher &) = delete;
+  Batcher &operator=(const Batcher &) = delete;
+
+  // Arguments after slices and num_slices, pending slices are launched
+  // with the previous ones first
+  template <typename... Args>
+  void bind(const Args &... args)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    launch_locked();
+
+    if(sizeof...(Args) + 2 != kernel_.num_args())
+    {
+      throw Error(CL_INVALID_KERNEL_ARGS, "batched kernel takes " +
+                  std::to_string(kernel_.num_args() - 2) + " arguments, " +
+                  std::to_string(sizeof...(Args)) + " given");
+    }
+
+    cl_uint index = 2;
+    (kernel_.set_arg(index++, args), ...);
+  }
+
+  // Any thread. The event is of the launch of the whole batch and is
+  // available once it is enqueued, the slice starts after deps
+  std::future<Event> submit(const BatchSlice &slice,
+                                                  const WaitList &deps = {});
+
+  // Launches the pending slices now
+  void flush();
+
+  // Waits for every launch so far
+  void finish();
+
+  size_t launches() const noexcept { return launches_; }
+  size_t slices() const noexcept { return slices_; }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  // Slices go to the device from host memory which must stay untouched
+  // until the upload is done, two slots let one batch fill while the
+  // previous one uploads
+  struct Slot
+  {
+    Slot(const Context &context, size_t capacity)
+      : device(context, capacity, CL_MEM_READ_ONLY) {}
+
+    std::vector<BatchSlice> host;
+    Buffer<BatchSlice> device;
+    Event upload;
+  };
+
+  // Nothing here throws, errors go to the futures of the batch
+  void launch_locked() noexcept;
+  void wait_for_deadlines();
+
+  BatchConfig config_;
+  Queue queue_;
+  Kernel kernel_;
+  std::vector<Slot> slots_;
+  size_t next_slot_ = 0;
+
+  std::vector<BatchSlice> pending_;
+  std::vector<std::promise<Event>> promises_;
+  std::vector<Event> deps_;
+  clock::time_point oldest_;
+
+  std::atomic<size_t> launches_{ 0 };
+  std::atomic<size_t> slices_{ 0 };
+
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  bool stop_ = false;
+  std::thread timer_;
+};
+
+} // namespace ocl2
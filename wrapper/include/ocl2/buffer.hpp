@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+//
+// Typed OpenCL buffer
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <type_traits>
+
+#include "ocl2/context.hpp"
+
+namespace ocl2
+{
+
+// Buffer of size() elements of T, all transfers are counted in elements
+template <typename T>
+class Buffer
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+                              "buffer element must be trivially copyable");
+
+public:
+  using value_type = T;
+
+  Buffer(const Context &context, size_t size,
+         cl_mem_flags flags = CL_MEM_READ_WRITE, T *host_ptr = nullptr)
+    : size_(size)
+  {
+    cl_int ret;
+    handle_.reset(clCreateBuffer(context.get(), flags, bytes(), host_ptr,
+                                                                        &ret));
+    OCL2_CHECK(ret);
+  }
+
+  cl_mem get() const noexcept { return handle_.get(); }
+  const cl_mem *address() const noexcept { return handle_.address(); }
+
+  size_t size() const noexcept { return size_; }
+  size_t bytes() const noexcept { return size_ * sizeof(T); }
+
+protected:
+  // Takes over one reference of an existing memory object, e.g. a sub-buffer
+  Buffer(cl_mem mem, size_t size) noexcept : handle_(mem), size_(size) {}
+
+private:
+  MemHandle handle_;
+  size_t size_;
+};
+
+} // namespace ocl2
@@ -0,0 +1,50 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL context and the device it is used with
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+
+#include "ocl2/device.hpp"
+#include "ocl2/handle.hpp"
+
+namespace ocl2
+{
+
+// Programs, queues and caches of the wrapper work with device(). A context
+// over several devices of one platform is used through one Context per
+// device sharing it, so its buffers are visible to all of them
+class Context
+{
+public:
+  explicit Context(Device device);
+
+  // Devices must be of the same platform, device() is the first one
+  explicit Context(const std::vector<Device> &devices);
+
+  // Shares the context of other with device, one of its devices
+  Context(const Context &other, Device device);
+
+  cl_context get() const noexcept { return handle_.get(); }
+  const Device &device() const noexcept { return device_; }
+  const std::vector<Device> &devices() const noexcept { return devices_; }
+
+private:
+  ContextHandle handle_;
+  Device device_;
+  std::vector<Device> devices_;
+};
+
+} // namespace ocl2
@@ -0,0 +1,128 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL device lookup
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ocl2/info.hpp"
+
+namespace ocl2
+{
+namespace detail
+{
+
+// Preferred and native vector width queries of each element type
+template <typename T>
+struct VectorWidthInfo;
+
+#define OCL2_VECTOR_WIDTH_INFO(type, name)                                     \
+  template <>                                                                  \
+  struct VectorWidthInfo<type>                                                 \
+  {                                                                            \
+    static constexpr cl_device_info preferred =                                \
+                                       CL_DEVICE_PREFERRED_VECTOR_WIDTH_##name; \
+    static constexpr cl_device_info native =                                   \
+                                          CL_DEVICE_NATIVE_VECTOR_WIDTH_##name; \
+  };
+
+OCL2_VECTOR_WIDTH_INFO(cl_char, CHAR)
+OCL2_VECTOR_WIDTH_INFO(cl_uchar, CHAR)
+OCL2_VECTOR_WIDTH_INFO(cl_short, SHORT)
+OCL2_VECTOR_WIDTH_INFO(cl_ushort, SHORT)
+OCL2_VECTOR_WIDTH_INFO(cl_int, INT)
+OCL2_VECTOR_WIDTH_INFO(cl_uint, INT)
+OCL2_VECTOR_WIDTH_INFO(cl_long, LONG)
+OCL2_VECTOR_WIDTH_INFO(cl_ulong, LONG)
+OCL2_VECTOR_WIDTH_INFO(cl_float, FLOAT)
+OCL2_VECTOR_WIDTH_INFO(cl_double, DOUBLE)
+
+#undef OCL2_VECTOR_WIDTH_INFO
+
+} // namespace detail
+
+
+
+// Root devices are owned by the platform, so Device is a plain value
+class Device
+{
+public:
+  Device() noexcept = default;
+  explicit Device(cl_device_id id) noexcept : id_(id) {}
+
+  cl_device_id get() const noexcept { return id_; }
+  explicit operator bool() const noexcept { return id_ != nullptr; }
+
+  template <typename T>
+  T info(cl_device_info param) const
+  {
+    return detail::get_info<T>(clGetDeviceInfo, id_, param);
+  }
+
+  std::string info_string(cl_device_info param) const
+  {
+    return detail::get_info_string(clGetDeviceInfo, id_, param);
+  }
+
+  std::string name() const { return info_string(CL_DEVICE_NAME); }
+  cl_device_type type() const { return info<cl_device_type>(CL_DEVICE_TYPE); }
+
+  cl_platform_id platform() const
+  {
+    return info<cl_platform_id>(CL_DEVICE_PLATFORM);
+  }
+
+  // Device and host share physical memory (CPU and integrated GPU), so
+  // buffers over host memory need no copies
+  bool host_unified_memory() const
+  {
+    return info<cl_bool>(CL_DEVICE_HOST_UNIFIED_MEMORY) == CL_TRUE;
+  }
+
+  cl_device_svm_capabilities svm_capabilities() const
+  {
+    return info<cl_device_svm_capabilities>(CL_DEVICE_SVM_CAPABILITIES);
+  }
+
+  // Vector width kernels on T elements should use: the larger of the
+  // preferred and native widths, as a power of two up to 16. It is 1 on
+  // devices that vectorize scalar code themselves, like most GPUs
+  template <typename T>
+  cl_uint vector_width() const
+  {
+    const cl_uint widest = std::max(
+                     info<cl_uint>(detail::VectorWidthInfo<T>::preferred),
+                     info<cl_uint>(detail::VectorWidthInfo<T>::native));
+
+    cl_uint width = 1;
+    while(width * 2 <= widest && width < 16)
+      width *= 2;
+
+    return width;
+  }
+
+  // All devices of the given type on all platforms
+  static std::vector<Device> all(cl_device_type type = CL_DEVICE_TYPE_ALL);
+
+  // First device of the given type, throws Error if there is none
+  static Device first(cl_device_type type);
+
+private:
+  cl_device_id id_ = nullptr;
+};
+
+} // namespace ocl2
@@ -0,0 +1,122 @@
+//-----------------------------------------------------------------------------
+//
+// Snapshot of device capabilities and device selection
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ocl2/device.hpp"
+
+namespace ocl2
+{
+
+// Everything selection and the examples ask about a device, queried once
+struct DeviceInfo
+{
+  Device device;
+  cl_uint platform_index = 0;
+  cl_uint device_index = 0; // within the platform
+
+  std::string platform_name;
+  std::string platform_version;
+  std::string name;
+  std::string vendor;
+  std::string version;
+  std::string driver_version;
+  std::string opencl_c_version;
+  std::string extensions;
+
+  cl_device_type type = 0;
+  cl_uint compute_units = 0;
+  cl_uint clock_mhz = 0;
+  cl_ulong global_memory = 0;
+  cl_ulong local_memory = 0;
+  cl_ulong max_alloc = 0;
+  size_t max_work_group_size = 0;
+  cl_device_svm_capabilities svm = 0;
+  bool available = false;
+  bool host_unified_memory = false;
+
+  // Compute units times clock, a rough measure to order devices by
+  double peak() const noexcept { return double(compute_units) * clock_mhz; }
+
+  bool has_extension(const std::string &extension) const;
+
+  // All of the above in one pass over clGetDeviceInfo
+  static DeviceInfo query(Device device, cl_uint platform_index,
+                                                       cl_uint device_index);
+};
+
+// Info of all devices of all platforms, taken once per process. With the
+// cache, only platform and driver versions, the device name and whether it
+// is available are queried and the rest is read from a file as long as
+// they match, so short-lived processes start without dozens of
+// clGetDeviceInfo calls per device
+const std::vector<DeviceInfo> &device_snapshot(bool use_cache = true);
+
+// OCL2_DEVICE_CACHE environment variable, or devices.txt under the cache
+// root. OCL2_DEVICE_CACHE=off disables the cache
+std::string device_cache_path();
+
+
+
+// Criteria a device must meet, unset ones match every device:
+// DeviceFilter().type(CL_DEVICE_TYPE_GPU).min_global_memory(1ull << 32)
+class DeviceFilter
+{
+public:
+  DeviceFilter &type(cl_device_type type)
+  {
+    type_ = type;
+    return *this;
+  }
+
+  // Case-insensitive substring of the device or platform name
+  DeviceFilter &name(std::string name)
+  {
+    name_ = std::move(name);
+    return *this;
+  }
+
+  DeviceFilter &min_global_memory(cl_ulong bytes)
+  {
+    min_global_memory_ = bytes;
+    return *this;
+  }
+
+  DeviceFilter &extension(std::string extension)
+  {
+    extensions_.push_back(std::move(extension));
+    return *this;
+  }
+
+  bool matches(const DeviceInfo &info) const;
+
+private:
+  cl_device_type type_ = CL_DEVICE_TYPE_ALL;
+  std::string name_;
+  cl_ulong min_global_memory_ = 0;
+  std::vector<std::string> extensions_;
+};
+
+// Available devices of the snapshot matching filter, highest peak() first
+std::vector<DeviceInfo> select_devices(const DeviceFilter &filter = {});
+
+// Fastest of them, throws Error if there is none
+Device select_device(const DeviceFilter &filter = {});
+
+} // namespace ocl2
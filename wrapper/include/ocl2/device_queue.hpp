@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+//
+// On-device queues kernels enqueue child kernels to
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "ocl2/context.hpp"
+#include "ocl2/kernel.hpp"
+
+namespace ocl2
+{
+
+// Queue living on the device, kernels built with -cl-std=CL2.0 launch
+// child kernels to it with enqueue_kernel without a round trip to the
+// host. The host only creates it and may pass it as a queue_t argument.
+// The default one is what get_default_queue() returns, it must exist
+// while kernels using it run. OpenCL 2.0
+class DeviceQueue
+{
+public:
+  // size is in bytes, 0 takes the preferred size of the device and larger
+  // sizes than the device allows are clamped
+  explicit DeviceQueue(const Context &context, bool is_default = true,
+                                                          cl_uint size = 0);
+
+  cl_command_queue get() const noexcept { return handle_.get(); }
+  const cl_command_queue *address() const noexcept
+  {
+    return handle_.address();
+  }
+
+  const Device &device() const noexcept { return device_; }
+  cl_uint size() const noexcept { return size_; }
+
+  // False on OpenCL 1.x devices and on 3.0 ones without device enqueue
+  static bool supported(const Device &device);
+
+  static cl_uint preferred_size(const Device &device);
+  static cl_uint max_size(const Device &device);
+
+private:
+  QueueHandle handle_;
+  Device device_;
+  cl_uint size_;
+};
+
+namespace detail
+{
+
+template <>
+struct KernelArg<DeviceQueue>
+{
+  static size_t size(const DeviceQueue &) noexcept
+  {
+    return sizeof(cl_command_queue);
+  }
+
+  static const void *value(const DeviceQueue &queue) noexcept
+  {
+    return queue.address();
+  }
+};
+
+} // namespace detail
+} // namespace ocl2
@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL errors as C++ exceptions
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+#include "ocl2/cl.hpp"
+
+namespace ocl2
+{
+
+const char *error_string(cl_int code) noexcept;
+
+class Error : public std::runtime_error
+{
+public:
+  Error(cl_int code, const char *filename, int line);
+  Error(cl_int code, const std::string &what);
+
+  cl_int code() const noexcept { return code_; }
+
+private:
+  cl_int code_;
+};
+
+// Thrown by Program::build, carries the build log of the failed device
+class BuildError : public Error
+{
+public:
+  BuildError(cl_int code, std::string log);
+
+  const std::string &log() const noexcept { return log_; }
+
+private:
+  std::string log_;
+};
+
+inline void check(cl_int ret, const char *filename, int line)
+{
+  if(ret != CL_SUCCESS)
+    throw Error(ret, filename, line);
+}
+
+} // namespace ocl2
+
+#define OCL2_CHECK(ret) ::ocl2::check((ret), __FILE__, __LINE__)
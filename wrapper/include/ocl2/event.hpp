@@ -0,0 +1,152 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL events and dependency lists
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ocl2/handle.hpp"
+#include "ocl2/info.hpp"
+#include "ocl2/trace.hpp"
+
+namespace ocl2
+{
+
+// Completion of one enqueued command. Every non-blocking enqueue returns an
+// Event that later commands can take as a dependency
+class Event
+{
+public:
+  Event() noexcept = default;
+  explicit Event(cl_event event) noexcept : handle_(event) {}
+
+  cl_event get() const noexcept { return handle_.get(); }
+  const cl_event *address() const noexcept { return handle_.address(); }
+  explicit operator bool() const noexcept { return static_cast<bool>(handle_); }
+
+  cl_int status() const
+  {
+    return detail::get_info<cl_int>(clGetEventInfo, get(),
+                                          CL_EVENT_COMMAND_EXECUTION_STATUS);
+  }
+
+  bool is_complete() const { return status() == CL_COMPLETE; }
+
+  void wait() const
+  {
+    TraceScope scope("Event::wait");
+    OCL2_CHECK(clWaitForEvents(1, address()));
+  }
+
+  // Device timer value in nanoseconds, the queue must have been created
+  // with CL_QUEUE_PROFILING_ENABLE
+  cl_ulong profiling(cl_profiling_info param) const
+  {
+    return detail::get_info<cl_ulong>(clGetEventProfilingInfo, get(), param);
+  }
+
+  // Composes the next stage of a pipeline: f gets this event to use as its
+  // dependency and returns the event of the commands it enqueued. Nothing
+  // waits on the host here
+  template <typename F>
+  auto then(F &&f) const -> decltype(std::forward<F>(f)(*this))
+  {
+    return std::forward<F>(f)(*this);
+  }
+
+  // Host callback called by the runtime once the command is complete or
+  // has failed, status is CL_COMPLETE or a negative error code
+  void on_complete(std::function<void(cl_int status)> callback) const
+  {
+    auto *heap_callback =
+                 new std::function<void(cl_int)>(std::move(callback));
+
+    cl_int ret = clSetEventCallback(get(), CL_COMPLETE, call_callback,
+                                                                 heap_callback);
+    if(ret != CL_SUCCESS)
+      delete heap_callback;
+    OCL2_CHECK(ret);
+  }
+
+private:
+  static void CL_CALLBACK call_callback(cl_event, cl_int status, void *data)
+  {
+    std::unique_ptr<std::function<void(cl_int)>> callback(
+                          static_cast<std::function<void(cl_int)> *>(data));
+    (*callback)(status);
+  }
+
+  EventHandle handle_;
+};
+
+
+
+// Non-owning list of events a command depends on, the events must outlive
+// the enqueue call only
+class WaitList
+{
+public:
+  WaitList() = default;
+  WaitList(const Event &event) { add(event); }
+
+  WaitList(std::initializer_list<std::reference_wrapper<const Event>> events)
+  {
+    for(const Event &event : events)
+      add(event);
+  }
+
+  WaitList(const std::vector<Event> &events)
+  {
+    for(const Event &event : events)
+      add(event);
+  }
+
+  void add(const Event &event)
+  {
+    if(event)
+      events_.push_back(event.get());
+  }
+
+  void add(const WaitList &other)
+  {
+    events_.insert(events_.end(), other.events_.begin(), other.events_.end());
+  }
+
+  bool empty() const noexcept { return events_.empty(); }
+  cl_uint size() const noexcept { return cl_uint(events_.size()); }
+
+  const cl_event *data() const noexcept
+  {
+    return events_.empty() ? nullptr : events_.data();
+  }
+
+  void wait() const
+  {
+    if(empty())
+      return;
+
+    TraceScope scope("WaitList::wait");
+    OCL2_CHECK(clWaitForEvents(size(), data()));
+  }
+
+private:
+  std::vector<cl_event> events_;
+};
+
+} // namespace ocl2
@@ -0,0 +1,503 @@
+//-----------------------------------------------------------------------------
+//
+// Elementwise expressions over buffers compiled into fused kernels
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ocl2/kernel.hpp"
+
+namespace ocl2
+{
+namespace detail
+{
+
+// OpenCL C name of an element or scalar type and its limits
+template <typename T>
+struct TypeName;
+
+#define OCL2_TYPE_NAME(type, name, lowest_value, highest_value)               \
+  template <>                                                                  \
+  struct TypeName<type>                                                        \
+  {                                                                            \
+    static constexpr const char *value = name;                                 \
+    static constexpr const char *lowest = lowest_value;                        \
+    static constexpr const char *highest = highest_value;                      \
+  };
+
+OCL2_TYPE_NAME(cl_char, "char", "SCHAR_MIN", "SCHAR_MAX")
+OCL2_TYPE_NAME(cl_uchar, "uchar", "0", "UCHAR_MAX")
+OCL2_TYPE_NAME(cl_short, "short", "SHRT_MIN", "SHRT_MAX")
+OCL2_TYPE_NAME(cl_ushort, "ushort", "0", "USHRT_MAX")
+OCL2_TYPE_NAME(cl_int, "int", "INT_MIN", "INT_MAX")
+OCL2_TYPE_NAME(cl_uint, "uint", "0", "UINT_MAX")
+OCL2_TYPE_NAME(cl_long, "long", "LONG_MIN", "LONG_MAX")
+OCL2_TYPE_NAME(cl_ulong, "ulong", "0", "ULONG_MAX")
+OCL2_TYPE_NAME(cl_float, "float", "(-INFINITY)", "INFINITY")
+OCL2_TYPE_NAME(cl_double, "double", "(-INFINITY)", "INFINITY")
+
+#undef OCL2_TYPE_NAME
+
+// Collects kernel parameters while an expression type is turned into the
+// kernel source
+class ExprWriter
+{
+public:
+  // Declares the next parameter and returns its name, pointer parameters
+  // are read-only global buffers
+  template <typename T>
+  std::string param(bool pointer)
+  {
+    const std::string name = "a" + std::to_string(params_.size());
+    params_.push_back(std::string(pointer ? "__global const " : "const ") +
+                      TypeName<T>::value + (pointer ? " *" : " ") + name);
+    fp64_ = fp64_ || std::is_same<T, cl_double>::value;
+    return name;
+  }
+
+  // Declared parameters, each preceded by a comma
+  std::string param_list() const;
+
+  bool uses_fp64() const noexcept { return fp64_; }
+
+  // Kernel ocl2_expr(out, params..., size) storing value into out[i]
+  std::string source(const char *out_type, bool out_fp64,
+                                               const std::string &value) const;
+
+private:
+  std::vector<std::string> params_;
+  bool fp64_ = false;
+};
+
+// Kernel of a generated program, launches hold the mutex from the first
+// set_arg to the enqueue
+struct GeneratedKernel
+{
+  GeneratedKernel(const Program &program, const std::string &name)
+    : kernel(program, name) {}
+
+  Kernel kernel;
+  std::mutex mutex;
+};
+
+// Kernel name of source built with options in the context. The program is
+// built on the first use of any of its kernels and kept until exit,
+// binaries come from the on-disk program cache when possible
+GeneratedKernel &generated_kernel(const Context &context,
+                                  const std::string &source,
+                                  const std::string &name,
+                                  const std::string &options = "");
+
+template <typename... Args>
+Event launch_generated(Queue &queue, GeneratedKernel &entry,
+                       const NDRange &range, const WaitList &deps,
+                                                       const Args &... args)
+{
+  std::lock_guard<std::mutex> lock(entry.mutex);
+  return entry.kernel.enqueue(queue, range, deps, args...);
+}
+
+// Power of two work-group size the kernel can run with, at most 256
+size_t generated_local_size(const Kernel &kernel, const Device &device);
+
+// Base of expression nodes, buffer leaves are made from Buffer<T> itself
+struct ExprNode
+{
+};
+
+template <typename E, typename = void>
+struct is_buffer : std::false_type
+{
+};
+
+template <typename E>
+struct is_buffer<E, std::void_t<typename E::value_type>>
+  : std::is_base_of<Buffer<typename E::value_type>, E>
+{
+};
+
+template <typename E>
+struct is_expr
+  : std::disjunction<std::is_base_of<ExprNode, E>, is_buffer<E>>
+{
+};
+
+} // namespace detail
+
+
+
+// Leaf reading element i of a buffer, the buffer must outlive the launch
+template <typename T>
+class BufferTerm : public detail::ExprNode
+{
+public:
+  using value_type = T;
+
+  explicit BufferTerm(const Buffer<T> &buffer) noexcept : buffer_(&buffer) {}
+
+  static std::string emit(detail::ExprWriter &writer)
+  {
+    return writer.param<T>(true) + "[i]";
+  }
+
+  void bind(Kernel &kernel, cl_uint &index) const
+  {
+    kernel.set_arg(index++, *buffer_);
+  }
+
+  size_t size() const noexcept { return buffer_->size(); }
+
+  void check_size(size_t size) const
+  {
+    if(buffer_->size() != size)
+    {
+      throw Error(CL_INVALID_VALUE, "expression operand of " +
+                  std::to_string(buffer_->size()) + " elements, result of " +
+                  std::to_string(size));
+    }
+  }
+
+private:
+  const Buffer<T> *buffer_;
+};
+
+// Constant of an expression. It is a kernel argument rather than a part of
+// the source, so expressions differing only in constants share the kernel
+template <typename T>
+class ScalarTerm : public detail::ExprNode
+{
+public:
+  using value_type = T;
+
+  explicit ScalarTerm(T value) noexcept : value_(value) {}
+
+  static std::string emit(detail::ExprWriter &writer)
+  {
+    return writer.param<T>(false);
+  }
+
+  void bind(Kernel &kernel, cl_uint &index) const
+  {
+    kernel.set_arg(index++, value_);
+  }
+
+  // Constants go with any number of elements
+  size_t size() const noexcept { return 0; }
+  void check_size(size_t) const noexcept {}
+
+private:
+  T value_;
+};
+
+template <typename Op, typename E>
+class UnaryExpr : public detail::ExprNode
+{
+public:
+  using value_type = typename Op::template result<typename E::value_type>;
+
+  explicit UnaryExpr(const E &arg) : arg_(arg) {}
+
+  static std::string emit(detail::ExprWriter &writer)
+  {
+    return Op::template apply<value_type>(E::emit(writer));
+  }
+
+  void bind(Kernel &kernel, cl_uint &index) const { arg_.bind(kernel, index); }
+  size_t size() const noexcept { return arg_.size(); }
+  void check_size(size_t size) const { arg_.check_size(size); }
+
+private:
+  E arg_;
+};
+
+template <typename Op, typename L, typename R>
+class BinaryExpr : public detail::ExprNode
+{
+public:
+  using value_type = typename Op::template result<typename L::value_type,
+                                                  typename R::value_type>;
+
+  BinaryExpr(const L &lhs, const R &rhs) : lhs_(lhs), rhs_(rhs) {}
+
+  static std::string emit(detail::ExprWriter &writer)
+  {
+    // Operands are declared left to right, the order bind() follows
+    std::string lhs = L::emit(writer);
+    std::string rhs = R::emit(writer);
+    return Op::template apply<value_type>(lhs, rhs);
+  }
+
+  void bind(Kernel &kernel, cl_uint &index) const
+  {
+    lhs_.bind(kernel, index);
+    rhs_.bind(kernel, index);
+  }
+
+  // Size of the first buffer, check_size() tells if the others match it
+  size_t size() const noexcept
+  {
+    return lhs_.size() != 0 ? lhs_.size() : rhs_.size();
+  }
+
+  void check_size(size_t size) const
+  {
+    lhs_.check_size(size);
+    rhs_.check_size(size);
+  }
+
+private:
+  L lhs_;
+  R rhs_;
+};
+
+namespace detail
+{
+
+template <typename E>
+auto as_expr(const E &expr)
+{
+  if constexpr(is_buffer<E>::value)
+    return BufferTerm<typename E::value_type>(expr);
+  else
+    return expr;
+}
+
+template <typename E>
+using expr_t = decltype(as_expr(std::declval<E>()));
+
+// Constants take the type of the other operand unless one is integral and
+// the other floating point, so A * 0.5 on floats stays in float while
+// A * 0.5 on ints is not truncated
+template <typename E, typename S>
+using scalar_t =
+  std::conditional_t<std::is_floating_point<E>::value ==
+                                       std::is_floating_point<S>::value, E, S>;
+
+template <typename E, typename Other>
+auto operand(const E &value)
+{
+  if constexpr(std::is_arithmetic<E>::value)
+  {
+    using T = scalar_t<typename expr_t<Other>::value_type, E>;
+    return ScalarTerm<T>(static_cast<T>(value));
+  }
+  else
+  {
+    return as_expr(value);
+  }
+}
+
+template <typename L, typename R>
+using enable_binary_t = std::enable_if_t<
+  (is_expr<L>::value && (is_expr<R>::value || std::is_arithmetic<R>::value)) ||
+  (std::is_arithmetic<L>::value && is_expr<R>::value)>;
+
+template <typename Op, typename L, typename R>
+auto make_binary(const L &lhs, const R &rhs)
+{
+  auto left = operand<L, R>(lhs);
+  auto right = operand<R, L>(rhs);
+  return BinaryExpr<Op, decltype(left), decltype(right)>(left, right);
+}
+
+template <typename T>
+std::string cast(const std::string &value)
+{
+  return std::string("(") + TypeName<T>::value + ")(" + value + ")";
+}
+
+struct Negate
+{
+  template <typename T>
+  using result = decltype(-std::declval<T>());
+
+  template <typename Result>
+  static std::string apply(const std::string &arg)
+  {
+    return "(-" + arg + ")";
+  }
+};
+
+// Built-in function of floating point values
+template <typename Name>
+struct MathFunction
+{
+  template <typename T>
+  using result = T;
+
+  template <typename Result>
+  static std::string apply(const std::string &arg)
+  {
+    static_assert(std::is_floating_point<Result>::value,
+                      "math functions take floating point expressions");
+    return std::string(Name::value) + "(" + arg + ")";
+  }
+};
+
+// Built-in function of two values, both converted to the result type since
+// OpenCL C doesn't convert arguments of overloaded built-ins
+template <typename Name>
+struct BinaryFunction
+{
+  template <typename L, typename R>
+  using result = decltype(std::declval<L>() + std::declval<R>());
+
+  template <typename Result>
+  static std::string apply(const std::string &lhs, const std::string &rhs)
+  {
+    return std::string(Name::value) + "(" + cast<Result>(lhs) + ", " +
+                                                    cast<Result>(rhs) + ")";
+  }
+};
+
+} // namespace detail
+
+
+
+#define OCL2_EXPR_OPERATOR(op, name)                                           \
+  namespace detail                                                             \
+  {                                                                            \
+  struct name                                                                  \
+  {                                                                            \
+    template <typename L, typename R>                                          \
+    using result = decltype(std::declval<L>() op std::declval<R>());           \
+                                                                               \
+    template <typename Result>                                                 \
+    static std::string apply(const std::string &lhs, const std::string &rhs)  \
+    {                                                                          \
+      return "(" + lhs + " " #op " " + rhs + ")";                              \
+    }                                                                          \
+  };                                                                           \
+  }                                                                            \
+                                                                               \
+  template <typename L, typename R, typename = detail::enable_binary_t<L, R>>  \
+  auto operator op(const L &lhs, const R &rhs)                                 \
+  {                                                                            \
+    return detail::make_binary<detail::name>(lhs, rhs);                        \
+  }
+
+OCL2_EXPR_OPERATOR(+, Plus)
+OCL2_EXPR_OPERATOR(-, Minus)
+OCL2_EXPR_OPERATOR(*, Multiplies)
+OCL2_EXPR_OPERATOR(/, Divides)
+
+#undef OCL2_EXPR_OPERATOR
+
+template <typename E, typename = std::enable_if_t<detail::is_expr<E>::value>>
+auto operator-(const E &arg)
+{
+  return UnaryExpr<detail::Negate, detail::expr_t<E>>(detail::as_expr(arg));
+}
+
+#define OCL2_EXPR_MATH_FUNCTION(name)                                          \
+  namespace detail                                                             \
+  {                                                                            \
+  struct name##_name                                                           \
+  {                                                                            \
+    static constexpr const char *value = #name;                                \
+  };                                                                           \
+  }                                                                            \
+                                                                               \
+  template <typename E, typename = std::enable_if_t<detail::is_expr<E>::value>> \
+  auto name(const E &arg)                                                      \
+  {                                                                            \
+    return UnaryExpr<detail::MathFunction<detail::name##_name>,               \
+                                 detail::expr_t<E>>(detail::as_expr(arg));     \
+  }
+
+OCL2_EXPR_MATH_FUNCTION(sqrt)
+OCL2_EXPR_MATH_FUNCTION(exp)
+OCL2_EXPR_MATH_FUNCTION(log)
+OCL2_EXPR_MATH_FUNCTION(fabs)
+OCL2_EXPR_MATH_FUNCTION(sin)
+OCL2_EXPR_MATH_FUNCTION(cos)
+
+#undef OCL2_EXPR_MATH_FUNCTION
+
+#define OCL2_EXPR_BINARY_FUNCTION(name)                                        \
+  namespace detail                                                             \
+  {                                                                            \
+  struct name##_name                                                           \
+  {                                                                            \
+    static constexpr const char *value = #name;                                \
+  };                                                                           \
+  }                                                                            \
+                                                                               \
+  template <typename L, typename R, typename = detail::enable_binary_t<L, R>>  \
+  auto name(const L &lhs, const R &rhs)                                        \
+  {                                                                            \
+    return detail::make_binary<detail::BinaryFunction<detail::name##_name>>(   \
+                                                                  lhs, rhs);   \
+  }
+
+OCL2_EXPR_BINARY_FUNCTION(min)
+OCL2_EXPR_BINARY_FUNCTION(max)
+OCL2_EXPR_BINARY_FUNCTION(pow)
+
+#undef OCL2_EXPR_BINARY_FUNCTION
+
+namespace detail
+{
+
+// Source of the kernel computing expressions of type E into T elements,
+// it depends only on the types
+template <typename T, typename E>
+std::string expr_source()
+{
+  ExprWriter writer;
+  const std::string value = E::emit(writer);
+  return writer.source(TypeName<T>::value, std::is_same<T, cl_double>::value,
+                                                                        value);
+}
+
+} // namespace detail
+
+
+
+// out[i] = expr[i] for every element in a single kernel, so A + B * 2 reads
+// A and B once and writes no temporaries. The kernel is generated from the
+// expression type and built once per context. Every buffer of expr must
+// have out.size() elements, out may be one of them
+template <typename T, typename E,
+                       typename = std::enable_if_t<detail::is_expr<E>::value>>
+Event assign(const Context &context, Queue &queue, Buffer<T> &out,
+                                    const E &expr, const WaitList &deps = {})
+{
+  using Expr = detail::expr_t<E>;
+  static const std::string source = detail::expr_source<T, Expr>();
+
+  const Expr root = detail::as_expr(expr);
+  root.check_size(out.size());
+
+  if(out.size() == 0)
+    return queue.enqueue_marker(deps);
+
+  detail::GeneratedKernel &entry = detail::generated_kernel(context, source,
+                                                                "ocl2_expr");
+  std::lock_guard<std::mutex> lock(entry.mutex);
+
+  cl_uint index = 0;
+  entry.kernel.set_arg(index++, out);
+  root.bind(entry.kernel, index);
+  entry.kernel.set_arg(index, cl_ulong(out.size()));
+
+  return queue.enqueue_ndrange(entry.kernel.get(), NDRange(out.size()), deps);
+}
+
+} // namespace ocl2
@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------
+//
+// Move-only owner of an OpenCL object
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <utility>
+
+#include "ocl2/cl.hpp"
+
+namespace ocl2
+{
+
+// Owns exactly one reference of the object, so moving it never touches the
+// OpenCL reference counter and copying is not possible at all
+template <typename T, cl_int (CL_API_CALL *Release)(T)>
+class Handle
+{
+public:
+  Handle() noexcept = default;
+  explicit Handle(T raw) noexcept : raw_(raw) {}
+
+  Handle(const Handle &) = delete;
+  Handle &operator=(const Handle &) = delete;
+
+  Handle(Handle &&other) noexcept : raw_(std::exchange(other.raw_, nullptr)) {}
+
+  Handle &operator=(Handle &&other) noexcept
+  {
+    if(this != &other)
+      reset(std::exchange(other.raw_, nullptr));
+    return *this;
+  }
+
+  ~Handle() { reset(); }
+
+  T get() const noexcept { return raw_; }
+  const T *address() const noexcept { return &raw_; }
+  explicit operator bool() const noexcept { return raw_ != nullptr; }
+
+  T release() noexcept { return std::exchange(raw_, nullptr); }
+
+  void reset(T raw = nullptr) noexcept
+  {
+    if(raw_ != nullptr)
+      Release(raw_);
+    raw_ = raw;
+  }
+
+private:
+  T raw_ = nullptr;
+};
+
+using ContextHandle = Handle<cl_context, clReleaseContext>;
+using QueueHandle = Handle<cl_command_queue, clReleaseCommandQueue>;
+using ProgramHandle = Handle<cl_program, clReleaseProgram>;
+using KernelHandle = Handle<cl_kernel, clReleaseKernel>;
+using MemHandle = Handle<cl_mem, clReleaseMemObject>;
+using EventHandle = Handle<cl_event, clReleaseEvent>;
+
+static_assert(sizeof(MemHandle) == sizeof(cl_mem),
+                                         "handle must be as small as raw one");
+
+} // namespace ocl2
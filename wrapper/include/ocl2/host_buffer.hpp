@@ -0,0 +1,209 @@
+//-----------------------------------------------------------------------------
+//
+// Zero-copy buffers over host memory and scoped map views
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "ocl2/kernel.hpp"
+
+namespace ocl2
+{
+
+enum class HostPlacement
+{
+  automatic,      // use_host_ptr on unified memory devices, else alloc_host_ptr
+  use_host_ptr,   // page-aligned memory allocated here, wrapped by the buffer
+  alloc_host_ptr, // host accessible memory allocated by the driver
+};
+
+namespace detail
+{
+
+constexpr size_t page_size = 4096;
+
+struct FreeDeleter
+{
+  void operator()(void *ptr) const noexcept { std::free(ptr); }
+};
+
+// Base of HostBuffer, so the memory exists before the buffer is created
+class PageAlignedMemory
+{
+protected:
+  explicit PageAlignedMemory(size_t bytes, bool allocate)
+  {
+    if(!allocate)
+      return;
+
+    // Drivers want both the address and the size aligned for zero-copy
+    const size_t aligned_bytes = (bytes + page_size - 1) / page_size *
+                                                                   page_size;
+    memory_.reset(std::aligned_alloc(page_size,
+                                      aligned_bytes ? aligned_bytes : page_size));
+    if(!memory_)
+      throw std::bad_alloc();
+  }
+
+  void *memory() const noexcept { return memory_.get(); }
+
+private:
+  std::unique_ptr<void, FreeDeleter> memory_;
+};
+
+inline bool use_host_ptr(const Context &context, HostPlacement placement)
+{
+  if(placement == HostPlacement::automatic)
+    return context.device().host_unified_memory();
+  return placement == HostPlacement::use_host_ptr;
+}
+
+} // namespace detail
+
+
+
+// Host access to a buffer region for the lifetime of the view
+template <typename T>
+class MappedView
+{
+public:
+  MappedView(const MappedView &) = delete;
+  MappedView &operator=(const MappedView &) = delete;
+
+  MappedView(MappedView &&other) noexcept
+    : queue_(other.queue_), mem_(other.mem_),
+      data_(std::exchange(other.data_, nullptr)), size_(other.size_),
+      mapped_(other.mapped_)
+  {
+  }
+
+  ~MappedView()
+  {
+    if(data_ != nullptr && mapped_)
+      clEnqueueUnmapMemObject(queue_, mem_, data_, 0, nullptr, nullptr);
+  }
+
+  T *data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+  T *begin() const noexcept { return data_; }
+  T *end() const noexcept { return data_ + size_; }
+  T &operator[](size_t i) const noexcept { return data_[i]; }
+
+  // Ends host access early, later device commands may depend on the event
+  Event unmap()
+  {
+    cl_event event = nullptr;
+    if(data_ != nullptr && mapped_)
+    {
+      OCL2_CHECK(clEnqueueUnmapMemObject(queue_, mem_, data_, 0, nullptr,
+                                                                    &event));
+    }
+    data_ = nullptr;
+    return Event(event);
+  }
+
+private:
+  template <typename> friend class HostBuffer;
+
+  MappedView(cl_command_queue queue, cl_mem mem, T *data, size_t size,
+                                                         bool mapped) noexcept
+    : queue_(queue), mem_(mem), data_(data), size_(size), mapped_(mapped)
+  {
+  }
+
+  cl_command_queue queue_;
+  cl_mem mem_;
+  T *data_;
+  size_t size_;
+  bool mapped_;
+};
+
+
+
+// Buffer living in host accessible memory. On unified memory devices it is
+// backed by page-aligned host memory and used by the device in place, so
+// filling it through map() costs no transfers at all
+template <typename T>
+class HostBuffer : private detail::PageAlignedMemory, public Buffer<T>
+{
+public:
+  HostBuffer(const Context &context, size_t size,
+             cl_mem_flags flags = CL_MEM_READ_WRITE,
+             HostPlacement placement = HostPlacement::automatic)
+    : HostBuffer(context, size, flags,
+                             detail::use_host_ptr(context, placement),
+                             context.device().host_unified_memory())
+  {
+  }
+
+  bool is_zero_copy() const noexcept { return zero_copy_; }
+
+  // Blocking map of the whole buffer after deps. When the device works on
+  // the host memory itself, nothing is enqueued and the view just points to
+  // it, so the caller must pass the events of commands still using it
+  MappedView<T> map(Queue &queue, cl_map_flags flags = CL_MAP_READ |
+                                                                  CL_MAP_WRITE,
+                                                   const WaitList &deps = {})
+  {
+    if(zero_copy_)
+    {
+      deps.wait();
+      return MappedView<T>(queue.get(), this->get(),
+                          static_cast<T *>(memory()), this->size(), false);
+    }
+
+    TraceScope scope("HostBuffer::map");
+    cl_int ret;
+    cl_event event;
+    void *data = clEnqueueMapBuffer(queue.get(), this->get(), CL_TRUE, flags,
+                        0, this->bytes(), deps.size(), deps.data(),
+                        queue.profiled(event), &ret);
+    OCL2_CHECK(ret);
+    if(queue.event_wanted())
+      queue.record(Event(event), "map", "map", this->bytes());
+
+    return MappedView<T>(queue.get(), this->get(), static_cast<T *>(data),
+                                                          this->size(), true);
+  }
+
+private:
+  HostBuffer(const Context &context, size_t size, cl_mem_flags flags,
+                                           bool use_host_ptr, bool unified)
+    : detail::PageAlignedMemory(size * sizeof(T), use_host_ptr),
+      Buffer<T>(context, size,
+                flags | (use_host_ptr ? CL_MEM_USE_HOST_PTR :
+                                        CL_MEM_ALLOC_HOST_PTR),
+                static_cast<T *>(memory())),
+      zero_copy_(use_host_ptr && unified)
+  {
+  }
+
+  bool zero_copy_;
+};
+
+namespace detail
+{
+
+template <typename T>
+struct KernelArg<HostBuffer<T>> : KernelArg<Buffer<T>>
+{
+};
+
+} // namespace detail
+
+} // namespace ocl2
@@ -0,0 +1,110 @@
+//-----------------------------------------------------------------------------
+//
+// Multi-threaded host reference computations and result checks
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "ocl2/cl.hpp"
+
+namespace ocl2
+{
+namespace host
+{
+
+// Threads the functions below use: OCL2_HOST_THREADS when it is set, all
+// hardware threads otherwise
+unsigned threads();
+
+// Calls body(begin, end) for chunks of grain items covering [0, count).
+// threads() threads take the next chunk as they finish the previous one
+void parallel_for(size_t count, size_t grain,
+                  const std::function<void(size_t begin, size_t end)> &body);
+
+// C[n x k] = A[n x m] * B[m x k], all row-major, no transposed copy of B
+// is needed. Threads take blocks of rows of C and keep small tiles of it
+// in vector registers while going over blocks of A and B that fit in the
+// caches. On x86-64 an AVX2 version is picked at load time when the CPU
+// has it
+void matrix_mult(const cl_int *A, const cl_int *B, cl_int *C, size_t n,
+                                                       size_t m, size_t k);
+void matrix_mult(const cl_float *A, const cl_float *B, cl_float *C,
+                                             size_t n, size_t m, size_t k);
+void matrix_mult(const cl_double *A, const cl_double *B, cl_double *C,
+                                             size_t n, size_t m, size_t k);
+
+// Indices of the first max_mismatches elements where actual and expected
+// differ by more than tolerance, in increasing order. A chunk that finds
+// max_mismatches on its own stops the chunks after it, so a wrong result
+// costs little
+template <typename T>
+std::vector<size_t> compare(const T *actual, const T *expected, size_t count,
+                            size_t max_mismatches, double tolerance = 0.0)
+{
+  if(max_mismatches == 0)
+    return {};
+
+  // Lowest start of a chunk that found max_mismatches, no chunk starting
+  // after it can hold any of the first ones
+  std::atomic<size_t> stop_at{ count };
+  std::mutex mutex;
+  std::vector<size_t> mismatches;
+
+  parallel_for(count, 1 << 16, [&](size_t begin, size_t end)
+  {
+    std::vector<size_t> local;
+    for(size_t i = begin; i < end; ++i)
+    {
+      if(((i - begin) & 4095) == 0 &&
+                      stop_at.load(std::memory_order_relaxed) < begin)
+      {
+        break;
+      }
+
+      if(std::abs(double(actual[i]) - double(expected[i])) > tolerance ||
+         (actual[i] != actual[i]) != (expected[i] != expected[i]))
+      {
+        local.push_back(i);
+        if(local.size() == max_mismatches)
+        {
+          size_t current = stop_at.load();
+          while(begin < current &&
+                           !stop_at.compare_exchange_weak(current, begin))
+          {
+          }
+          break;
+        }
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    mismatches.insert(mismatches.end(), local.begin(), local.end());
+  });
+
+  std::sort(mismatches.begin(), mismatches.end());
+  if(mismatches.size() > max_mismatches)
+    mismatches.resize(max_mismatches);
+
+  return mismatches;
+}
+
+} // namespace host
+} // namespace ocl2
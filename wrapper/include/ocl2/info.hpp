@@ -0,0 +1,57 @@
+//-----------------------------------------------------------------------------
+//
+// Helpers around clGet*Info queries
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ocl2/error.hpp"
+
+namespace ocl2
+{
+namespace detail
+{
+
+template <typename T, typename Getter, typename Object, typename Param>
+T get_info(Getter getter, Object object, Param param)
+{
+  T value;
+  OCL2_CHECK(getter(object, param, sizeof(T), &value, nullptr));
+  return value;
+}
+
+template <typename T, typename Getter, typename Object, typename Param>
+std::vector<T> get_info_vector(Getter getter, Object object, Param param)
+{
+  size_t size;
+  OCL2_CHECK(getter(object, param, 0, nullptr, &size));
+
+  std::vector<T> values(size / sizeof(T));
+  OCL2_CHECK(getter(object, param, size, values.data(), nullptr));
+  return values;
+}
+
+template <typename Getter, typename Object, typename Param>
+std::string get_info_string(Getter getter, Object object, Param param)
+{
+  std::vector<char> chars = get_info_vector<char>(getter, object, param);
+  while(!chars.empty() && chars.back() == '\0')
+    chars.pop_back();
+  return std::string(chars.begin(), chars.end());
+}
+
+} // namespace detail
+} // namespace ocl2
@@ -0,0 +1,311 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL kernel
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ocl2/program.hpp"
+#include "ocl2/queue.hpp"
+#include "ocl2/svm.hpp"
+
+namespace ocl2
+{
+
+// __local argument of size() elements of T
+template <typename T>
+class LocalMemory
+{
+public:
+  explicit LocalMemory(size_t size) noexcept : size_(size) {}
+
+  size_t size() const noexcept { return size_; }
+  size_t bytes() const noexcept { return size_ * sizeof(T); }
+
+private:
+  size_t size_;
+};
+
+namespace detail
+{
+
+// Size and address of the value passed to clSetKernelArg, only the types
+// with a specialization or a plain value layout can be bound
+template <typename T>
+struct KernelArg
+{
+  static_assert(!std::is_pointer<T>::value,
+                           "host pointers can't be kernel arguments, use Buffer");
+  static_assert(!std::is_same<T, bool>::value,
+                                       "bool is not a valid kernel argument");
+  static_assert(std::is_trivially_copyable<T>::value,
+                             "kernel argument must be trivially copyable");
+
+  static size_t size(const T &) noexcept { return sizeof(T); }
+  static const void *value(const T &arg) noexcept { return &arg; }
+};
+
+template <typename T>
+struct KernelArg<Buffer<T>>
+{
+  static size_t size(const Buffer<T> &) noexcept { return sizeof(cl_mem); }
+
+  static const void *value(const Buffer<T> &buffer) noexcept
+  {
+    return buffer.address();
+  }
+};
+
+template <typename T>
+struct KernelArg<LocalMemory<T>>
+{
+  static size_t size(const LocalMemory<T> &local) noexcept
+  {
+    return local.bytes();
+  }
+
+  static const void *value(const LocalMemory<T> &) noexcept { return nullptr; }
+};
+
+// Argument type accepted for a parameter of KernelFunctor signature, any
+// buffer type built on Buffer<T> goes for Buffer<T>
+template <typename Arg, typename Param>
+struct ArgMatches : std::is_same<Arg, Param>
+{
+};
+
+template <typename Arg, typename T>
+struct ArgMatches<Arg, Buffer<T>> : std::is_base_of<Buffer<T>, Arg>
+{
+};
+
+template <typename T>
+struct ArgMatches<svm_vector<T>, SvmPointer<T>> : std::true_type
+{
+};
+
+} // namespace detail
+
+
+
+class Kernel
+{
+public:
+  Kernel(const Program &program, const std::string &name)
+    : Kernel(program.get(), name) {}
+
+  // clCreateKernel is thread-safe, so any thread may create kernels of a
+  // program another thread owns
+  Kernel(cl_program program, const std::string &name)
+  {
+    cl_int ret;
+    handle_.reset(clCreateKernel(program, name.c_str(), &ret));
+    OCL2_CHECK(ret);
+
+    bound_.resize(detail::get_info<cl_uint>(clGetKernelInfo, get(),
+                                                        CL_KERNEL_NUM_ARGS));
+  }
+
+  cl_kernel get() const noexcept { return handle_.get(); }
+  cl_uint num_args() const noexcept { return cl_uint(bound_.size()); }
+
+  template <typename T>
+  void set_arg(cl_uint index, const T &arg)
+  {
+    using Arg = detail::KernelArg<T>;
+    bind(index, Arg::size(arg), Arg::value(arg));
+  }
+
+  template <typename T>
+  void set_arg(cl_uint index, const SvmPointer<T> &arg)
+  {
+    bind_svm(index, arg.get());
+  }
+
+  template <typename T>
+  void set_arg(cl_uint index, const svm_vector<T> &arg)
+  {
+    bind_svm(index, arg.data());
+  }
+
+  // SVM allocations the kernel reaches through pointers stored in other SVM
+  // memory rather than through its arguments, e.g. nodes of a linked list
+  void use_svm_pointers(const std::vector<const void *> &pointers)
+  {
+    std::vector<void *> values;
+    for(const void *ptr : pointers)
+      values.push_back(const_cast<void *>(ptr));
+
+    OCL2_CHECK(clSetKernelExecInfo(get(), CL_KERNEL_EXEC_INFO_SVM_PTRS,
+                         values.size() * sizeof(void *), values.data()));
+  }
+
+  // Binds all arguments in order, values equal to the ones bound by the
+  // previous call are not passed to the driver again
+  template <typename... Args>
+  void set_args(const Args &... args)
+  {
+    if(sizeof...(Args) != bound_.size())
+    {
+      throw Error(CL_INVALID_KERNEL_ARGS, "kernel takes " +
+                      std::to_string(bound_.size()) + " arguments, " +
+                      std::to_string(sizeof...(Args)) + " given");
+    }
+
+    cl_uint index = 0;
+    (set_arg(index++, args), ...);
+  }
+
+  template <typename... Args>
+  Event operator()(Queue &queue, const NDRange &range, const Args &... args)
+  {
+    set_args(args...);
+    return queue.enqueue_ndrange(get(), range);
+  }
+
+  // Launch that starts only after all of deps are complete
+  template <typename... Args>
+  Event enqueue(Queue &queue, const NDRange &range, const WaitList &deps,
+                                                         const Args &... args)
+  {
+    set_args(args...);
+    return queue.enqueue_ndrange(get(), range, deps);
+  }
+
+  // Independent kernel object with the arguments bound so far, another
+  // thread can bind and launch it while this one changes. OpenCL 2.1
+  Kernel clone() const
+  {
+    cl_int ret;
+    cl_kernel kernel = clCloneKernel(get(), &ret);
+    OCL2_CHECK(ret);
+
+    return Kernel(kernel, bound_);
+  }
+
+private:
+  struct BoundArg
+  {
+    enum { CACHED_SIZE = 16 };
+
+    bool valid = false;
+    bool is_local = false;
+    bool is_svm = false;
+    size_t size = 0;
+    unsigned char bytes[CACHED_SIZE];
+  };
+
+  void bind(cl_uint index, size_t size, const void *value)
+  {
+    if(index >= bound_.size())
+      throw Error(CL_INVALID_ARG_INDEX, "kernel argument index out of range");
+
+    BoundArg &arg = bound_[index];
+    const bool is_local = (value == nullptr);
+    const bool cacheable = is_local || size <= sizeof(arg.bytes);
+
+    if(arg.valid && !arg.is_svm && arg.is_local == is_local &&
+       arg.size == size &&
+       (is_local || std::memcmp(arg.bytes, value, size) == 0))
+    {
+      return;
+    }
+
+    arg.valid = false;
+    OCL2_CHECK(clSetKernelArg(get(), index, size, value));
+
+    arg.valid = cacheable;
+    arg.is_local = is_local;
+    arg.is_svm = false;
+    arg.size = size;
+    if(cacheable && !is_local)
+      std::memcpy(arg.bytes, value, size);
+  }
+
+  void bind_svm(cl_uint index, const void *ptr)
+  {
+    if(index >= bound_.size())
+      throw Error(CL_INVALID_ARG_INDEX, "kernel argument index out of range");
+
+    BoundArg &arg = bound_[index];
+    if(arg.valid && arg.is_svm && std::memcmp(arg.bytes, &ptr, sizeof(ptr)) == 0)
+      return;
+
+    arg.valid = false;
+    OCL2_CHECK(clSetKernelArgSVMPointer(get(), index, ptr));
+
+    arg.valid = true;
+    arg.is_local = false;
+    arg.is_svm = true;
+    arg.size = sizeof(ptr);
+    std::memcpy(arg.bytes, &ptr, sizeof(ptr));
+  }
+
+  Kernel(cl_kernel kernel, std::vector<BoundArg> bound) noexcept
+    : handle_(kernel), bound_(std::move(bound)) {}
+
+  KernelHandle handle_;
+  std::vector<BoundArg> bound_;
+};
+
+
+
+// Kernel with a signature fixed at compile time. Every argument must have
+// exactly the declared type, so passing size_t where the kernel takes
+// cl_int does not compile
+template <typename... Params>
+class KernelFunctor
+{
+public:
+  KernelFunctor(const Program &program, const std::string &name)
+    : kernel_(program, name)
+  {
+    if(kernel_.num_args() != sizeof...(Params))
+    {
+      throw Error(CL_INVALID_KERNEL_ARGS, "kernel '" + name + "' takes " +
+                      std::to_string(kernel_.num_args()) + " arguments, " +
+                      std::to_string(sizeof...(Params)) + " declared");
+    }
+  }
+
+  template <typename... Args>
+  Event operator()(Queue &queue, const NDRange &range, const Args &... args)
+  {
+    return enqueue(queue, range, {}, args...);
+  }
+
+  template <typename... Args>
+  Event enqueue(Queue &queue, const NDRange &range, const WaitList &deps,
+                                                         const Args &... args)
+  {
+    static_assert(sizeof...(Args) == sizeof...(Params),
+                                    "wrong number of kernel arguments");
+    static_assert(std::conjunction<detail::ArgMatches<Args, Params>...>::value,
+                        "kernel argument type does not match the signature");
+
+    return kernel_.enqueue(queue, range, deps, args...);
+  }
+
+  Kernel &kernel() noexcept { return kernel_; }
+
+private:
+  Kernel kernel_;
+};
+
+} // namespace ocl2
@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+//
+// Work split across the devices of all platforms
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ocl2/queue.hpp"
+
+namespace ocl2
+{
+
+// Items [offset, offset + count) of a split range given to one device
+struct Share
+{
+  size_t device; // index in MultiDevice
+  size_t offset;
+  size_t count;
+};
+
+// Devices with a queue each. Devices of one platform share a context, so
+// buffers of that context can be used by all of them. Ranges are split in
+// proportion to the throughput of the devices, which is measured on every
+// run() and converges to the split where all of them finish together
+class MultiDevice
+{
+public:
+  // All devices of type on all platforms, throws Error if there are none
+  explicit MultiDevice(cl_device_type type = CL_DEVICE_TYPE_ALL);
+  explicit MultiDevice(const std::vector<Device> &devices);
+
+  size_t size() const noexcept { return members_.size(); }
+
+  const Context &context(size_t i) const { return members_[i].context; }
+  const Device &device(size_t i) const { return context(i).device(); }
+  Queue &queue(size_t i) { return members_[i].queue; }
+
+  // Items per second device i was measured at. Devices that never ran yet
+  // get compute units times clock, scaled like the measured ones
+  double throughput(size_t i) const;
+
+  // Weight of a new measurement against the previous throughput, 1 keeps
+  // only the last run
+  void set_smoothing(double smoothing) noexcept { smoothing_ = smoothing; }
+
+  // [0, total) in contiguous shares in device order. Counts are multiples
+  // of granularity, except for the one ending at total. Devices whose
+  // share rounds down to nothing are left out
+  std::vector<Share> split(size_t total, size_t granularity = 1) const;
+
+  // Calls launch(share) for every share of split(total, granularity).
+  // launch enqueues the work on queue(share.device) and returns the event
+  // of its last command. Waits for all shares and updates the throughput
+  // of each device from the time between its launch and that event
+  template <typename F>
+  std::vector<Share> run(size_t total, size_t granularity, F &&launch)
+  {
+    std::vector<Share> shares = split(total, granularity);
+    auto done = std::make_shared<Completion>(shares.size());
+
+    for(size_t i = 0; i < shares.size(); ++i)
+    {
+      done->start[i] = std::chrono::steady_clock::now();
+
+      const Event event = launch(shares[i]);
+      event.on_complete([done, i](cl_int status)
+      {
+        done->finish(i, status);
+      });
+
+      queue(shares[i].device).flush();
+    }
+
+    wait(*done, shares);
+    return shares;
+  }
+
+private:
+  struct Member
+  {
+    Member(Context view, double power)
+      : context(std::move(view)), queue(context), estimate(power) {}
+
+    Context context;
+    Queue queue;
+    double estimate;          // compute units * MHz
+    double throughput = 0.0;  // items per second, 0 until measured
+  };
+
+  // Filled by event callbacks on runtime threads
+  struct Completion
+  {
+    explicit Completion(size_t shares) : start(shares), seconds(shares),
+                                                             pending(shares) {}
+
+    void finish(size_t i, cl_int status);
+
+    std::vector<std::chrono::steady_clock::time_point> start;
+    std::vector<double> seconds;
+    size_t pending;
+    cl_int status = CL_SUCCESS;
+    std::mutex mutex;
+    std::condition_variable all_done;
+  };
+
+  void wait(Completion &done, const std::vector<Share> &shares);
+
+  std::vector<Member> members_;
+  double smoothing_ = 0.5;
+};
+
+} // namespace ocl2
@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+//
+// Global and local work sizes of a kernel launch
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include "ocl2/error.hpp"
+
+namespace ocl2
+{
+
+// NDRange(n) or NDRange({ n, k }, { 16, 16 }), empty local size leaves
+// the choice to the driver
+class NDRange
+{
+public:
+  NDRange(size_t global) : dims_(1) { global_[0] = global; }
+
+  NDRange(std::initializer_list<size_t> global,
+          std::initializer_list<size_t> local = {})
+  {
+    assign(global, local);
+  }
+
+  // Sizes known at run time only
+  NDRange(const std::vector<size_t> &global,
+          const std::vector<size_t> &local)
+  {
+    assign(global, local);
+  }
+
+  cl_uint dims() const noexcept { return dims_; }
+  const size_t *global() const noexcept { return global_; }
+  const size_t *local() const noexcept { return has_local_ ? local_ : nullptr; }
+
+  size_t global_size() const noexcept
+  {
+    return global_[0] * global_[1] * global_[2];
+  }
+
+private:
+  template <typename Sizes>
+  void assign(const Sizes &global, const Sizes &local)
+  {
+    dims_ = static_cast<cl_uint>(global.size());
+    has_local_ = (local.size() != 0);
+
+    if(dims_ == 0 || dims_ > 3 || (has_local_ && local.size() != dims_))
+      throw Error(CL_INVALID_WORK_DIMENSION, "bad NDRange dimensions");
+
+    std::copy(global.begin(), global.end(), global_);
+    std::copy(local.begin(), local.end(), local_);
+  }
+
+  size_t global_[3] = { 1, 1, 1 };
+  size_t local_[3] = { 1, 1, 1 };
+  cl_uint dims_ = 1;
+  bool has_local_ = false;
+};
+
+} // namespace ocl2
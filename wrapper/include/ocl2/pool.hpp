@@ -0,0 +1,194 @@
+//-----------------------------------------------------------------------------
+//
+// Device memory pool handing out sub-buffers of large slabs
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ocl2/kernel.hpp"
+
+namespace ocl2
+{
+
+struct PoolStats
+{
+  size_t requests = 0;
+  size_t hits = 0;            // requests served by a recycled block
+  size_t slabs = 0;
+  size_t reserved_bytes = 0;  // all slabs together
+  size_t in_use_bytes = 0;    // blocks handed out, rounded to size classes
+  size_t requested_bytes = 0; // what was asked for the blocks in use
+  size_t cached_bytes = 0;    // released blocks, completed or still pending
+  size_t wasted_bytes = 0;    // slab tails too small for the block after them
+
+  double hit_rate() const
+  {
+    return requests == 0 ? 0.0 : double(hits) / requests;
+  }
+
+  // Share of the handed out memory lost to size class rounding
+  double internal_fragmentation() const
+  {
+    return in_use_bytes == 0 ? 0.0 :
+                           1.0 - double(requested_bytes) / in_use_bytes;
+  }
+
+  // Share of the reserved memory no block can ever be carved from
+  double external_fragmentation() const
+  {
+    return reserved_bytes == 0 ? 0.0 : double(wasted_bytes) / reserved_bytes;
+  }
+};
+
+namespace detail
+{
+
+// Sub-buffer of a slab, the pool keeps its own reference to mem for reuse
+struct PoolBlock
+{
+  cl_mem mem = nullptr;
+  size_t bytes = 0;
+};
+
+} // namespace detail
+
+template <typename T>
+class PooledBuffer;
+
+
+
+// Blocks are power of two size classes no smaller than the device base
+// address alignment, carved one after another from slabs, so every
+// sub-buffer origin stays aligned. A released block is reused only after
+// its last-use event is complete. The pool must outlive its buffers
+class BufferPool
+{
+public:
+  explicit BufferPool(const Context &context, size_t slab_bytes = 64 << 20,
+                                   cl_mem_flags flags = CL_MEM_READ_WRITE);
+
+  BufferPool(const BufferPool &) = delete;
+  BufferPool &operator=(const BufferPool &) = delete;
+
+  template <typename T>
+  PooledBuffer<T> acquire(size_t size)
+  {
+    return PooledBuffer<T>(*this, acquire_block(size * sizeof(T)), size);
+  }
+
+  // Moves the released blocks whose last use is complete back to the bins,
+  // acquire() does it by itself
+  void collect();
+
+  PoolStats stats() const;
+  size_t alignment() const noexcept { return alignment_; }
+  size_t slab_bytes() const noexcept { return slab_bytes_; }
+
+  detail::PoolBlock acquire_block(size_t bytes);
+  void release_block(detail::PoolBlock block, size_t requested_bytes,
+                                                              Event last_use);
+
+private:
+  struct Slab
+  {
+    MemHandle mem;
+    size_t bytes;
+    size_t used;
+  };
+
+  struct Pending
+  {
+    detail::PoolBlock block;
+    Event last_use;
+  };
+
+  size_t size_class(size_t bytes) const noexcept;
+  detail::PoolBlock carve(size_t bytes);
+  void collect_locked();
+
+  cl_context context_;
+  cl_mem_flags flags_;
+  size_t alignment_;
+  size_t slab_bytes_;
+
+  mutable std::mutex mutex_;
+  std::vector<Slab> slabs_;
+  std::vector<MemHandle> blocks_;
+  std::map<size_t, std::vector<detail::PoolBlock>> bins_;
+  std::vector<Pending> pending_;
+  PoolStats stats_;
+};
+
+
+
+// Buffer whose memory goes back to the pool on destruction. Commands
+// still using it must be reported through set_last_use()
+template <typename T>
+class PooledBuffer : public Buffer<T>
+{
+public:
+  PooledBuffer(BufferPool &pool, detail::PoolBlock block, size_t size)
+    : Buffer<T>(retained(block.mem), size), pool_(&pool), block_(block)
+  {
+  }
+
+  PooledBuffer(PooledBuffer &&other) noexcept
+    : Buffer<T>(std::move(other)), pool_(std::exchange(other.pool_, nullptr)),
+      block_(other.block_), last_use_(std::move(other.last_use_))
+  {
+  }
+
+  PooledBuffer &operator=(PooledBuffer &&) = delete;
+
+  ~PooledBuffer()
+  {
+    if(pool_ != nullptr)
+      pool_->release_block(block_, this->bytes(), std::move(last_use_));
+  }
+
+  // The block is not handed out again until event is complete
+  void set_last_use(const Event &event)
+  {
+    if(event)
+      OCL2_CHECK(clRetainEvent(event.get()));
+    last_use_ = Event(event.get());
+  }
+
+private:
+  static cl_mem retained(cl_mem mem)
+  {
+    OCL2_CHECK(clRetainMemObject(mem));
+    return mem;
+  }
+
+  BufferPool *pool_;
+  detail::PoolBlock block_;
+  Event last_use_;
+};
+
+namespace detail
+{
+
+template <typename T>
+struct KernelArg<PooledBuffer<T>> : KernelArg<Buffer<T>>
+{
+};
+
+} // namespace detail
+
+} // namespace ocl2
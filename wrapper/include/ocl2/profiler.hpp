@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+//
+// Per-command profiling of queues
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ocl2/event.hpp"
+
+namespace ocl2
+{
+
+// Device timestamps of one command in nanoseconds, along with the amount
+// of work it did
+struct CommandProfile
+{
+  std::string name;   // kernel function name or transfer kind
+  size_t bytes = 0;   // moved by a transfer, or annotated for a kernel
+  double flops = 0.0; // annotated for a kernel
+  cl_ulong queued = 0;
+  cl_ulong submit = 0;
+  cl_ulong start = 0;
+  cl_ulong end = 0;
+
+  // Seconds from enqueue on the host to the start on the device
+  double queue_delay() const { return (start - queued) * 1e-9; }
+  double execution_time() const { return (end - start) * 1e-9; }
+
+  // Bytes per second
+  double bandwidth() const
+  {
+    return end == start ? 0.0 : bytes / execution_time();
+  }
+
+  double gflops() const
+  {
+    return end == start ? 0.0 : flops * 1e-9 / execution_time();
+  }
+};
+
+
+
+// Collects every command enqueued through the queues it is attached to.
+// Events are kept until results() asks for their timestamps, so
+// long-running loops should clear() the profiler now and then
+class Profiler
+{
+public:
+  void record(cl_event event, std::string name, size_t bytes = 0);
+
+  // Sets the work of an already recorded command, e.g. the flop count of a
+  // kernel the profiler can't know itself
+  void annotate(const Event &event, double flops, size_t bytes = 0);
+
+  // Waits for all recorded commands
+  std::vector<CommandProfile> results() const;
+
+  // Table of all commands followed by the totals per name
+  void report(std::ostream &os) const;
+
+  void clear();
+
+private:
+  struct Record
+  {
+    EventHandle event;
+    std::string name;
+    size_t bytes;
+    double flops;
+  };
+
+  mutable std::mutex mutex_;
+  std::vector<Record> records_;
+};
+
+} // namespace ocl2
@@ -0,0 +1,106 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL program
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ocl2/context.hpp"
+
+namespace ocl2
+{
+
+// Kernel text with its SPIR-V, spirv_size is 0 when there is none
+struct ProgramSource
+{
+  const char *text;
+  size_t size;
+  const void *spirv = nullptr;
+  size_t spirv_size = 0;
+};
+
+// ProgramSource of a file embedded by ocl2_embed_kernels() in CMake, name
+// is the file name without extension
+#define OCL2_EMBEDDED(name) \
+  ::ocl2::ProgramSource{ name##_source, name##_source_size, \
+                                          name##_spirv, name##_spirv_size }
+
+class Program
+{
+public:
+  static Program from_source(const Context &context,
+                                                   const std::string &source);
+  static Program from_binary(const Context &context,
+                                   const std::vector<unsigned char> &binary);
+
+  // Reads the whole file, there is no limit on the source size
+  static Program from_file(const Context &context,
+                                                  const std::string &filename);
+
+  // SPIR-V or another intermediate language of the device, OpenCL 2.1
+  static Program from_il(const Context &context, const void *il,
+                                                                 size_t size);
+
+  // Built program, binary is taken from the on-disk cache when possible.
+  // Cache entries are shared with the raw OpenCL examples
+  static Program build_cached(const Context &context,
+                              const std::string &source,
+                              const std::string &options = "");
+
+  // Built from SPIR-V when source has it and the device takes it, skipping
+  // the compiler front end. -D options can't change SPIR-V, with any of
+  // them the text is built, through the binary cache if use_cache is set
+  static Program build_from(const Context &context,
+                            const ProgramSource &source,
+                            const std::string &options = "",
+                            bool use_cache = true);
+
+  // Throws BuildError with the build log on failure
+  void build(const std::string &options = "");
+
+  std::string build_log() const;
+  std::vector<unsigned char> binary() const;
+
+  cl_program get() const noexcept { return handle_.get(); }
+  const Device &device() const noexcept { return device_; }
+
+private:
+  Program(cl_program program, Device device) noexcept
+    : handle_(program), device_(device) {}
+
+  ProgramHandle handle_;
+  Device device_;
+};
+
+std::string read_file(const std::string &filename);
+
+namespace detail
+{
+
+// Hash of source, device name, driver version and options. It keys the
+// program binary cache and the other per-device caches
+uint64_t program_key(const Device &device, const std::string &source,
+                                                  const std::string &options);
+
+// $HOME/.cache/ocl2, every on-disk cache of the wrapper lives under it
+std::string cache_root();
+
+bool make_dirs(const std::string &path);
+
+} // namespace detail
+
+} // namespace ocl2
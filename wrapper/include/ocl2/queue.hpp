@@ -0,0 +1,165 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL command queue
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "ocl2/buffer.hpp"
+#include "ocl2/event.hpp"
+#include "ocl2/ndrange.hpp"
+#include "ocl2/profiler.hpp"
+#include "ocl2/trace.hpp"
+
+namespace ocl2
+{
+
+class Queue
+{
+public:
+  explicit Queue(const Context &context, cl_command_queue_properties
+                                                          properties = 0);
+
+  // Profiling queue, every command enqueued through it is recorded by
+  // profiler, which must outlive the queue
+  Queue(const Context &context, Profiler &profiler,
+                              cl_command_queue_properties properties = 0);
+
+  cl_command_queue get() const noexcept { return handle_.get(); }
+  const Device &device() const noexcept { return device_; }
+
+  // Blocking transfers of the whole buffer
+  template <typename T>
+  void write(Buffer<T> &buffer, const T *host)
+  {
+    TraceScope scope("Queue::write");
+    cl_event event;
+    OCL2_CHECK(clEnqueueWriteBuffer(get(), buffer.get(), CL_TRUE, 0,
+                        buffer.bytes(), host, 0, nullptr, profiled(event)));
+    if(event_wanted())
+      record(Event(event), "transfer", "write", buffer.bytes());
+  }
+
+  template <typename T>
+  void read(const Buffer<T> &buffer, T *host)
+  {
+    TraceScope scope("Queue::read");
+    cl_event event;
+    OCL2_CHECK(clEnqueueReadBuffer(get(), buffer.get(), CL_TRUE, 0,
+                        buffer.bytes(), host, 0, nullptr, profiled(event)));
+    if(event_wanted())
+      record(Event(event), "transfer", "read", buffer.bytes());
+  }
+
+  // Non-blocking transfers, host memory must stay valid until the returned
+  // event is complete. Offset and count are in elements
+  template <typename T>
+  Event enqueue_write(Buffer<T> &buffer, const T *host,
+                                                   const WaitList &deps = {})
+  {
+    return enqueue_write(buffer, host, 0, buffer.size(), deps);
+  }
+
+  template <typename T>
+  Event enqueue_write(Buffer<T> &buffer, const T *host, size_t offset,
+                               size_t count, const WaitList &deps = {})
+  {
+    cl_event event;
+    OCL2_CHECK(clEnqueueWriteBuffer(get(), buffer.get(), CL_FALSE,
+                          offset * sizeof(T), count * sizeof(T), host,
+                          deps.size(), deps.data(), &event));
+    return record(Event(event), "transfer", "write", count * sizeof(T));
+  }
+
+  template <typename T>
+  Event enqueue_read(const Buffer<T> &buffer, T *host,
+                                                   const WaitList &deps = {})
+  {
+    return enqueue_read(buffer, host, 0, buffer.size(), deps);
+  }
+
+  template <typename T>
+  Event enqueue_read(const Buffer<T> &buffer, T *host, size_t offset,
+                               size_t count, const WaitList &deps = {})
+  {
+    cl_event event;
+    OCL2_CHECK(clEnqueueReadBuffer(get(), buffer.get(), CL_FALSE,
+                          offset * sizeof(T), count * sizeof(T), host,
+                          deps.size(), deps.data(), &event));
+    return record(Event(event), "transfer", "read", count * sizeof(T));
+  }
+
+  Event enqueue_ndrange(cl_kernel kernel, const NDRange &range,
+                                                   const WaitList &deps = {})
+  {
+    cl_event event;
+    OCL2_CHECK(clEnqueueNDRangeKernel(get(), kernel, range.dims(), nullptr,
+                  range.global(), range.local(), deps.size(), deps.data(),
+                  &event));
+    if(!event_wanted())
+      return Event(event);
+
+    return record(Event(event), "kernel", detail::get_info_string(
+                           clGetKernelInfo, kernel, CL_KERNEL_FUNCTION_NAME));
+  }
+
+  // Completes once all of deps are complete, or all previously enqueued
+  // commands if deps is empty
+  Event enqueue_marker(const WaitList &deps = {})
+  {
+    cl_event event;
+    OCL2_CHECK(clEnqueueMarkerWithWaitList(get(), deps.size(), deps.data(),
+                                                                      &event));
+    return Event(event);
+  }
+
+  void flush() { OCL2_CHECK(clFlush(get())); }
+
+  void finish()
+  {
+    TraceScope scope("Queue::finish");
+    OCL2_CHECK(clFinish(get()));
+  }
+
+  Profiler *profiler() const noexcept { return profiler_; }
+
+  // Commands enqueued on get() directly are reported here to show up in
+  // the profiler and the trace. Blocking ones get an event only if it is
+  // wanted, profiled() gives the event argument for them
+  bool event_wanted() const noexcept
+  {
+    return profiler_ != nullptr || trace::enabled();
+  }
+
+  cl_event *profiled(cl_event &event) const noexcept
+  {
+    return event_wanted() ? &event : nullptr;
+  }
+
+  Event record(Event event, const char *category, std::string name,
+                                                          size_t bytes = 0)
+  {
+    detail::trace_command(get(), event.get(), category, name, bytes);
+    if(profiler_ != nullptr)
+      profiler_->record(event.get(), std::move(name), bytes);
+    return event;
+  }
+
+private:
+
+  QueueHandle handle_;
+  Device device_;
+  Profiler *profiler_ = nullptr;
+};
+
+} // namespace ocl2
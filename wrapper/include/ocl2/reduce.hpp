@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+//
+// Parallel reduction of buffers and elementwise expressions
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+
+#include "ocl2/expr.hpp"
+
+namespace ocl2
+{
+
+// Associative operation of a reduction written in OpenCL C. The result
+// type is T there, and T_MIN and T_MAX are its limits
+struct ReduceOp
+{
+  std::string combine;  // expression of a and b, "a * b"
+  std::string identity; // value i with combine(i, x) == x, "1"
+  std::string builtin;  // work_group_reduce_<builtin> doing the same, if any
+
+  static ReduceOp sum() { return { "a + b", "0", "add" }; }
+  static ReduceOp min() { return { "min(a, b)", "T_MAX", "min" }; }
+  static ReduceOp max() { return { "max(a, b)", "T_MIN", "max" }; }
+};
+
+namespace detail
+{
+
+struct ReduceType
+{
+  const char *name;
+  const char *lowest;
+  const char *highest;
+  bool fp64;
+  // work_group_reduce_* take 32 and 64-bit types only
+  bool collective;
+};
+
+template <typename T>
+ReduceType reduce_type()
+{
+  return { TypeName<T>::value, TypeName<T>::lowest, TypeName<T>::highest,
+           std::is_same<T, cl_double>::value, sizeof(T) >= 4 };
+}
+
+// Defines of T, T_MIN, T_MAX, IDENTITY and COMBINE(a, b), and of macro as
+// work_group_<function>_<op.builtin> when the device compiler has it
+std::string reduce_defines(const ReduceType &type, const ReduceOp &op,
+                           bool fp64, const char *macro,
+                                                   const char *function);
+
+// Kernel ocl2_reduce(out, params..., size, scratch), each work-group
+// combines value over its share of the elements into out[group]
+std::string reduce_source(const ExprWriter &writer, const ReduceType &type,
+                          const ReduceOp &op, const std::string &value);
+
+// -cl-std of the device's OpenCL C when it is 2.0 or later, so kernels can
+// see the work-group functions
+std::string reduce_options(const Device &device);
+
+template <typename T, typename E>
+GeneratedKernel &reduce_kernel(const Context &context, const ReduceOp &op)
+{
+  ExprWriter writer;
+  const std::string value = E::emit(writer);
+
+  return generated_kernel(context,
+                          reduce_source(writer, reduce_type<T>(), op, value),
+                          "ocl2_reduce", reduce_options(context.device()));
+}
+
+template <typename T, typename E>
+Event launch_reduce(Queue &queue, GeneratedKernel &entry, const E &root,
+                    size_t size, Buffer<T> &out, size_t groups, size_t local,
+                                                        const WaitList &deps)
+{
+  std::lock_guard<std::mutex> lock(entry.mutex);
+
+  cl_uint index = 0;
+  entry.kernel.set_arg(index++, out);
+  root.bind(entry.kernel, index);
+  entry.kernel.set_arg(index++, cl_ulong(size));
+  entry.kernel.set_arg(index, LocalMemory<T>(local));
+
+  return queue.enqueue_ndrange(entry.kernel.get(),
+                               NDRange({ groups * local }, { local }), deps);
+}
+
+} // namespace detail
+
+
+
+// Combines all elements of expr with op into result[0] on the device. Each
+// work-group of the first pass reduces a strided share of the elements,
+// with work_group_reduce_* when the device has them and a tree in __local
+// memory otherwise, and a single work-group combines the partial results.
+// expr may be a buffer or any elementwise expression, e.g. A * B for a dot
+// product, which is then computed without temporaries
+template <typename T, typename E,
+                       typename = std::enable_if_t<detail::is_expr<E>::value>>
+Event enqueue_reduce(const Context &context, Queue &queue, const E &expr,
+                     Buffer<T> &result, const ReduceOp &op = ReduceOp::sum(),
+                                                 const WaitList &deps = {})
+{
+  using Expr = detail::expr_t<E>;
+  const Expr root = detail::as_expr(expr);
+  const size_t size = root.size();
+  root.check_size(size);
+
+  detail::GeneratedKernel &first = detail::reduce_kernel<T, Expr>(context, op);
+  const size_t local = detail::generated_local_size(first.kernel,
+                                                            context.device());
+  const size_t groups = std::clamp<size_t>((size + local - 1) / local, 1,
+                                                                      local);
+
+  if(groups == 1)
+  {
+    return detail::launch_reduce(queue, first, root, size, result, 1, local,
+                                                                        deps);
+  }
+
+  Buffer<T> partials(context, groups);
+  const Event partial = detail::launch_reduce(queue, first, root, size,
+                                              partials, groups, local, deps);
+
+  detail::GeneratedKernel &last =
+                      detail::reduce_kernel<T, BufferTerm<T>>(context, op);
+  return detail::launch_reduce(queue, last, BufferTerm<T>(partials), groups,
+                 result, 1,
+                 detail::generated_local_size(last.kernel, context.device()),
+                 partial);
+}
+
+// Blocking reduction, only the result element is read back
+template <typename E,
+                       typename = std::enable_if_t<detail::is_expr<E>::value>>
+auto reduce(const Context &context, Queue &queue, const E &expr,
+                                        const ReduceOp &op = ReduceOp::sum())
+{
+  using T = typename detail::expr_t<E>::value_type;
+
+  Buffer<T> result(context, 1);
+  const Event done = enqueue_reduce(context, queue, expr, result, op);
+
+  T value;
+  queue.enqueue_read(result, &value, done).wait();
+  return value;
+}
+
+} // namespace ocl2
@@ -0,0 +1,96 @@
+//-----------------------------------------------------------------------------
+//
+// Task graph scheduled over several queues or an out-of-order queue
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ocl2/queue.hpp"
+
+namespace ocl2
+{
+
+using TaskId = size_t;
+
+// Enqueues the commands of a task on queue after deps and returns the event
+// of its last command, or an empty event to wait for everything enqueued on
+// queue so far. On an out-of-order queue the commands of a task must be
+// chained through their events, nothing orders them otherwise
+using TaskFunction = std::function<Event(Queue &queue, const WaitList &deps)>;
+
+// Tasks and the tasks each of them waits for. A task can only depend on
+// tasks added before it, so ids are a topological order and there are no
+// cycles
+class TaskGraph
+{
+public:
+  struct Task
+  {
+    TaskFunction function;
+    std::vector<TaskId> deps;
+    std::string name;
+  };
+
+  TaskId add(TaskFunction function, std::vector<TaskId> deps = {},
+                                                     std::string name = "");
+
+  size_t size() const noexcept { return tasks_.size(); }
+  const Task &task(TaskId id) const { return tasks_.at(id); }
+
+private:
+  std::vector<Task> tasks_;
+};
+
+
+
+// Enqueues task graphs so that independent tasks run concurrently, either
+// on several in-order queues or on one out-of-order queue where only the
+// dependencies order the commands
+class Scheduler
+{
+public:
+  explicit Scheduler(const Context &context, size_t num_queues = 4,
+                               cl_command_queue_properties properties = 0);
+
+  // Throws Error if the device has no out-of-order queues
+  static Scheduler out_of_order(const Context &context,
+                               cl_command_queue_properties properties = 0);
+
+  static bool supports_out_of_order(const Device &device);
+
+  size_t size() const noexcept { return queues_.size(); }
+  Queue &queue(size_t i) { return queues_.at(i); }
+
+  // Enqueues every task of graph, tasks without dependencies wait for deps.
+  // A task continues on the queue of a dependency it was the last one on,
+  // others go round the queues. Returns the events of the tasks by id and
+  // leaves all queues flushed
+  std::vector<Event> enqueue(const TaskGraph &graph,
+                                                   const WaitList &deps = {});
+
+  // Enqueues graph and waits for all of its tasks
+  void run(const TaskGraph &graph, const WaitList &deps = {});
+
+private:
+  explicit Scheduler(std::vector<Queue> queues) noexcept
+    : queues_(std::move(queues)) {}
+
+  std::vector<Queue> queues_;
+  size_t next_ = 0;
+};
+
+} // namespace ocl2
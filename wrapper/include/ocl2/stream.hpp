@@ -0,0 +1,196 @@
+//-----------------------------------------------------------------------------
+//
+// Streaming of host ranges larger than device memory
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "ocl2/kernel.hpp"
+
+namespace ocl2
+{
+
+struct StreamStats
+{
+  size_t chunks = 0;
+  double span = 0.0;          // seconds from the first command start to the
+                              // last command end on the device
+  double transfer_time = 0.0; // seconds spent in uploads and downloads
+  double compute_time = 0.0;  // seconds spent in kernels
+
+  // 1 means the commands were fully serialized, the upper bound is the
+  // number of engines kept busy at the same time
+  double overlap() const noexcept
+  {
+    return (span > 0.0) ? (transfer_time + compute_time) / span : 0.0;
+  }
+};
+
+// Device buffers of one pipeline slot, inputs and outputs hold chunk_size
+// elements, only the first size of them belong to the current chunk
+template <typename T>
+struct StreamChunk
+{
+  size_t index;
+  size_t offset; // of the chunk in the host range
+  size_t size;
+  std::vector<Buffer<T>> &inputs;
+  std::vector<Buffer<T>> &outputs;
+};
+
+// Splits a host range into chunks and pipelines them through depth slots
+// of device buffers. Consecutive chunks go to two queues in turn, so while
+// one chunk computes the next one uploads and the previous one downloads
+template <typename T>
+class StreamExecutor
+{
+public:
+  using Launch = std::function<Event(Queue &queue, StreamChunk<T> &chunk,
+                                                      const WaitList &deps)>;
+
+  StreamExecutor(const Context &context, size_t num_inputs, size_t num_outputs,
+                                           size_t chunk_size, size_t depth = 3)
+    : chunk_size_(chunk_size)
+  {
+    if(chunk_size == 0 || depth < 2)
+      throw Error(CL_INVALID_VALUE, "stream needs chunks and two slots");
+
+    for(int i = 0; i < 2; ++i)
+      queues_.emplace_back(context, CL_QUEUE_PROFILING_ENABLE);
+
+    slots_.resize(depth);
+    for(Slot &slot : slots_)
+    {
+      for(size_t i = 0; i < num_inputs; ++i)
+        slot.inputs.emplace_back(context, chunk_size, CL_MEM_READ_ONLY);
+      for(size_t i = 0; i < num_outputs; ++i)
+        slot.outputs.emplace_back(context, chunk_size, CL_MEM_WRITE_ONLY);
+    }
+  }
+
+  size_t chunk_size() const noexcept { return chunk_size_; }
+  size_t depth() const noexcept { return slots_.size(); }
+
+  // launch enqueues the computation of one chunk on the given queue after
+  // deps and returns its event
+  StreamStats run(const std::vector<const T *> &inputs,
+                  const std::vector<T *> &outputs, size_t size,
+                                                          const Launch &launch)
+  {
+    if(inputs.size() != slots_[0].inputs.size() ||
+                                   outputs.size() != slots_[0].outputs.size())
+    {
+      throw Error(CL_INVALID_VALUE, "stream inputs or outputs mismatch");
+    }
+
+    StreamStats stats;
+    Timeline timeline;
+
+    for(size_t offset = 0, index = 0; offset < size;
+                                               offset += chunk_size_, ++index)
+    {
+      Slot &slot = slots_[index % slots_.size()];
+      Queue &queue = queues_[index % queues_.size()];
+      const size_t count = std::min(chunk_size_, size - offset);
+
+      // The slot is still owned by the chunk depth steps back. Waiting for
+      // it keeps depth - 1 chunks in flight and bounds the number of events
+      retire(slot, stats, timeline);
+
+      WaitList uploaded;
+      for(size_t i = 0; i < inputs.size(); ++i)
+      {
+        slot.uploads.push_back(queue.enqueue_write(slot.inputs[i],
+                                        inputs[i] + offset, 0, count));
+        uploaded.add(slot.uploads.back());
+      }
+
+      StreamChunk<T> chunk{ index, offset, count, slot.inputs, slot.outputs };
+      slot.compute = launch(queue, chunk, uploaded);
+
+      for(size_t i = 0; i < outputs.size(); ++i)
+      {
+        slot.downloads.push_back(queue.enqueue_read(slot.outputs[i],
+                                  outputs[i] + offset, 0, count, slot.compute));
+      }
+
+      queue.flush();
+      ++stats.chunks;
+    }
+
+    for(Slot &slot : slots_)
+      retire(slot, stats, timeline);
+
+    if(timeline.last_end > timeline.first_start)
+      stats.span = (timeline.last_end - timeline.first_start) * 1e-9;
+
+    return stats;
+  }
+
+private:
+  struct Slot
+  {
+    std::vector<Buffer<T>> inputs;
+    std::vector<Buffer<T>> outputs;
+    std::vector<Event> uploads;
+    Event compute;
+    std::vector<Event> downloads;
+  };
+
+  struct Timeline
+  {
+    cl_ulong first_start = std::numeric_limits<cl_ulong>::max();
+    cl_ulong last_end = 0;
+  };
+
+  static double account(const Event &event, Timeline &timeline)
+  {
+    const cl_ulong start = event.profiling(CL_PROFILING_COMMAND_START);
+    const cl_ulong end = event.profiling(CL_PROFILING_COMMAND_END);
+
+    timeline.first_start = std::min(timeline.first_start, start);
+    timeline.last_end = std::max(timeline.last_end, end);
+
+    return (end - start) * 1e-9;
+  }
+
+  static void retire(Slot &slot, StreamStats &stats, Timeline &timeline)
+  {
+    WaitList pending(slot.downloads);
+    pending.add(slot.compute);
+    pending.add(slot.uploads);
+    pending.wait();
+
+    for(const Event &event : slot.uploads)
+      stats.transfer_time += account(event, timeline);
+    if(slot.compute)
+      stats.compute_time += account(slot.compute, timeline);
+    for(const Event &event : slot.downloads)
+      stats.transfer_time += account(event, timeline);
+
+    slot.uploads.clear();
+    slot.compute = Event();
+    slot.downloads.clear();
+  }
+
+  size_t chunk_size_;
+  std::vector<Queue> queues_;
+  std::vector<Slot> slots_;
+};
+
+} // namespace ocl2
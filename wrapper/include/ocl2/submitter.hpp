@@ -0,0 +1,243 @@
+//-----------------------------------------------------------------------------
+//
+// Kernel submission from many host threads through a lock-free ring
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ocl2/kernel.hpp"
+
+namespace ocl2
+{
+namespace detail
+{
+
+// Bounded ring any number of threads push to and one thread pops from.
+// Every cell carries a sequence number telling whose turn it is, so a push
+// is one compare-and-swap of the tail and no thread ever waits on a lock
+template <typename T>
+class MpscRing
+{
+public:
+  // capacity is rounded up to a power of two
+  explicit MpscRing(size_t capacity)
+  {
+    size_t size = 1;
+    while(size < capacity)
+      size *= 2;
+
+    cells_.reset(new Cell[size]);
+    mask_ = size - 1;
+    for(size_t i = 0; i < size; ++i)
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  // Any thread, false if the ring is full and value is left as it was
+  bool try_push(T &value)
+  {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+
+    for(;;)
+    {
+      Cell &cell = cells_[pos & mask_];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+
+      if(diff == 0)
+      {
+        if(tail_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+        {
+          cell.value = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if(diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Consumer thread only
+  bool ready() const
+  {
+    return cells_[head_ & mask_].sequence.load(std::memory_order_acquire) ==
+                                                                   head_ + 1;
+  }
+
+  bool try_pop(T &value)
+  {
+    if(!ready())
+      return false;
+
+    Cell &cell = cells_[head_ & mask_];
+    value = std::move(cell.value);
+    cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> tail_{ 0 };
+  alignas(64) size_t head_ = 0;
+};
+
+// Kernel objects of one producer and one kernel name that no launch is
+// using. The producer takes them and the dispatcher gives them back after
+// the enqueue, so launches don't create and release kernel objects
+using KernelRing = MpscRing<std::unique_ptr<Kernel>>;
+
+// Kernel with its arguments bound and what it waits for, owned by the ring
+// until the dispatcher enqueues it
+struct Submission
+{
+  Submission(std::unique_ptr<Kernel> kernel,
+             std::shared_ptr<KernelRing> free, const NDRange &range,
+                                       const WaitList &deps, size_t shard);
+
+  std::unique_ptr<Kernel> kernel;
+  std::shared_ptr<KernelRing> free;
+  NDRange range;
+  std::vector<Event> deps;
+  size_t shard;
+  std::promise<Event> done;
+};
+
+} // namespace detail
+
+
+
+// Launches kernels of one program from any number of host threads. Every
+// thread binds arguments on its own kernel objects, so no two threads
+// share argument state, and hands the launch to a dispatcher thread
+// through a lock-free ring. The dispatcher enqueues launches on the queue
+// shard of their thread, flushes once per batch and returns the kernel
+// objects to their thread for the next launches
+class Submitter
+{
+public:
+  // Handle of one host thread, it must not be shared between threads or
+  // outlive the submitter
+  class Producer
+  {
+  public:
+    // Event of the launch is available once the dispatcher has enqueued
+    // it. Launches of one producer are enqueued in the order of submit
+    template <typename... Args>
+    std::future<Event> submit(const std::string &name, const NDRange &range,
+                              const WaitList &deps, const Args &... args)
+    {
+      const std::shared_ptr<detail::KernelRing> &free = kernels(name);
+      std::unique_ptr<Kernel> kernel;
+      if(!free->try_pop(kernel))
+        kernel = std::make_unique<Kernel>(submitter_->program_.get(), name);
+
+      // Arguments equal to the ones of an earlier launch of this kernel
+      // object are not passed to the driver again
+      kernel->set_args(args...);
+
+      auto submission = std::make_unique<detail::Submission>(
+                               std::move(kernel), free, range, deps, shard_);
+      std::future<Event> done = submission->done.get_future();
+      submitter_->push(submission);
+      return done;
+    }
+
+    size_t shard() const noexcept { return shard_; }
+
+  private:
+    friend class Submitter;
+
+    Producer(Submitter &submitter, size_t shard) noexcept
+      : submitter_(&submitter), shard_(shard) {}
+
+    const std::shared_ptr<detail::KernelRing> &kernels(
+                                                   const std::string &name);
+
+    Submitter *submitter_;
+    size_t shard_;
+    std::map<std::string, std::shared_ptr<detail::KernelRing>> free_;
+  };
+
+  // Capacity of the ring bounds the launches waiting for the dispatcher,
+  // producers yield while it is full
+  Submitter(const Context &context, const Program &program,
+            size_t num_queues = 4, size_t capacity = 1024,
+            cl_command_queue_properties properties = 0);
+
+  // Enqueues everything submitted before and stops the dispatcher
+  ~Submitter();
+
+  Submitter(const Submitter &) = delete;
+  Submitter &operator=(const Submitter &) = delete;
+
+  // Producers take the queue shards in turn
+  Producer producer();
+
+  size_t size() const noexcept { return queues_.size(); }
+
+  // Waits until everything submitted before is enqueued and complete
+  void finish();
+
+private:
+  using SubmissionPtr = std::unique_ptr<detail::Submission>;
+
+  void push(SubmissionPtr &submission);
+  void dispatch();
+  void wake();
+
+  ProgramHandle program_;
+  std::set<std::string> names_;
+  size_t capacity_;
+  std::vector<Queue> queues_;
+  detail::MpscRing<SubmissionPtr> ring_;
+  std::atomic<size_t> next_shard_{ 0 };
+  std::atomic<size_t> submitted_{ 0 };
+  std::atomic<size_t> dispatched_{ 0 };
+
+  // Taken only to put the idle dispatcher to sleep and to wake it up
+  std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::atomic<bool> sleeping_{ false };
+  bool stop_ = false;
+
+  std::thread dispatcher_;
+};
+
+} // namespace ocl2
@@ -0,0 +1,215 @@
+//-----------------------------------------------------------------------------
+//
+// Shared virtual memory allocator and mappings
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "ocl2/queue.hpp"
+
+namespace ocl2
+{
+
+enum class SvmGrain
+{
+  coarse,       // host access only inside svm_map() scopes
+  fine,         // host and device access the memory at any time
+  fine_atomics, // fine grain with atomics visible across host and device
+};
+
+namespace detail
+{
+
+inline cl_svm_mem_flags svm_flags(SvmGrain grain) noexcept
+{
+  switch(grain)
+  {
+  case SvmGrain::coarse:
+    return CL_MEM_READ_WRITE;
+  case SvmGrain::fine:
+    return CL_MEM_READ_WRITE | CL_MEM_SVM_FINE_GRAIN_BUFFER;
+  case SvmGrain::fine_atomics:
+    return CL_MEM_READ_WRITE | CL_MEM_SVM_FINE_GRAIN_BUFFER |
+                                                            CL_MEM_SVM_ATOMICS;
+  }
+
+  return CL_MEM_READ_WRITE;
+}
+
+inline void check_svm_support(const Device &device, SvmGrain grain)
+{
+  const cl_device_svm_capabilities caps = device.svm_capabilities();
+  cl_device_svm_capabilities needed = CL_DEVICE_SVM_COARSE_GRAIN_BUFFER;
+
+  if(grain != SvmGrain::coarse)
+    needed |= CL_DEVICE_SVM_FINE_GRAIN_BUFFER;
+  if(grain == SvmGrain::fine_atomics)
+    needed |= CL_DEVICE_SVM_ATOMICS;
+
+  if((caps & needed) != needed)
+    throw Error(CL_INVALID_OPERATION, "device lacks requested SVM support");
+}
+
+} // namespace detail
+
+
+
+// Allocator for standard containers in SVM, so that
+// std::vector<int, svm_allocator<int>> goes straight to kernels. The context
+// is not retained and must outlive every container using the allocator
+template <typename T>
+class svm_allocator
+{
+public:
+  using value_type = T;
+
+  explicit svm_allocator(const Context &context,
+                                         SvmGrain grain = SvmGrain::coarse)
+    : context_(context.get()), grain_(grain)
+  {
+    detail::check_svm_support(context.device(), grain);
+  }
+
+  template <typename U>
+  svm_allocator(const svm_allocator<U> &other) noexcept
+    : context_(other.context()), grain_(other.grain())
+  {
+  }
+
+  T *allocate(size_t n)
+  {
+    void *ptr = clSVMAlloc(context_, detail::svm_flags(grain_), n * sizeof(T),
+                                                                   alignof(T));
+    if(ptr == nullptr)
+      throw std::bad_alloc();
+
+    return static_cast<T *>(ptr);
+  }
+
+  void deallocate(T *ptr, size_t) noexcept { clSVMFree(context_, ptr); }
+
+  cl_context context() const noexcept { return context_; }
+  SvmGrain grain() const noexcept { return grain_; }
+
+  template <typename U>
+  bool operator==(const svm_allocator<U> &other) const noexcept
+  {
+    return context_ == other.context() && grain_ == other.grain();
+  }
+
+  template <typename U>
+  bool operator!=(const svm_allocator<U> &other) const noexcept
+  {
+    return !(*this == other);
+  }
+
+private:
+  cl_context context_;
+  SvmGrain grain_;
+};
+
+template <typename T>
+using svm_vector = std::vector<T, svm_allocator<T>>;
+
+
+
+// SVM pointer kernel argument, bound with clSetKernelArgSVMPointer
+template <typename T>
+class SvmPointer
+{
+public:
+  explicit SvmPointer(T *ptr) noexcept : ptr_(ptr) {}
+
+  T *get() const noexcept { return ptr_; }
+
+private:
+  T *ptr_;
+};
+
+template <typename T>
+SvmPointer<T> svm_ptr(T *ptr) noexcept
+{
+  return SvmPointer<T>(ptr);
+}
+
+
+
+// Host access scope of coarse grain SVM, a no-op for fine grain memory
+class SvmMapping
+{
+public:
+  SvmMapping(Queue &queue, void *ptr, size_t bytes, SvmGrain grain,
+             cl_map_flags flags = CL_MAP_READ | CL_MAP_WRITE,
+                                                   const WaitList &deps = {})
+    : queue_(queue.get()), ptr_(nullptr)
+  {
+    if(grain != SvmGrain::coarse)
+    {
+      deps.wait();
+      return;
+    }
+
+    TraceScope scope("svm_map");
+    cl_event event;
+    OCL2_CHECK(clEnqueueSVMMap(queue_, CL_TRUE, flags, ptr, bytes,
+                          deps.size(), deps.data(), queue.profiled(event)));
+    if(queue.event_wanted())
+      queue.record(Event(event), "map", "svm map", bytes);
+    ptr_ = ptr;
+  }
+
+  SvmMapping(const SvmMapping &) = delete;
+  SvmMapping &operator=(const SvmMapping &) = delete;
+
+  SvmMapping(SvmMapping &&other) noexcept
+    : queue_(other.queue_), ptr_(std::exchange(other.ptr_, nullptr))
+  {
+  }
+
+  ~SvmMapping()
+  {
+    if(ptr_ != nullptr)
+      clEnqueueSVMUnmap(queue_, ptr_, 0, nullptr, nullptr);
+  }
+
+  // Ends host access early, later device commands may depend on the event
+  Event unmap()
+  {
+    cl_event event = nullptr;
+    if(ptr_ != nullptr)
+      OCL2_CHECK(clEnqueueSVMUnmap(queue_, ptr_, 0, nullptr, &event));
+    ptr_ = nullptr;
+    return Event(event);
+  }
+
+private:
+  cl_command_queue queue_;
+  void *ptr_;
+};
+
+// Maps the whole capacity, so a reserved but empty vector can be filled
+// inside the scope
+template <typename T>
+SvmMapping svm_map(Queue &queue, svm_vector<T> &vector,
+                   cl_map_flags flags = CL_MAP_READ | CL_MAP_WRITE,
+                                                   const WaitList &deps = {})
+{
+  return SvmMapping(queue, vector.data(), vector.capacity() * sizeof(T),
+                               vector.get_allocator().grain(), flags, deps);
+}
+
+} // namespace ocl2
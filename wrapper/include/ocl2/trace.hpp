@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+//
+// Chrome trace timeline of queue and host activity
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+
+#include "ocl2/cl.hpp"
+
+namespace ocl2
+{
+
+// Tracing is on when OCL2_TRACE environment variable names the output file.
+// Queues are created with profiling enabled then, every command they
+// enqueue and every blocking host call of the wrapper is recorded, and the
+// trace is written as Chrome trace JSON at exit. It opens in Perfetto or
+// chrome://tracing
+namespace trace
+{
+
+bool enabled() noexcept;
+
+// Writes everything recorded so far without waiting for the exit
+void flush();
+
+// Host time in nanoseconds on the clock the trace uses
+cl_ulong host_now() noexcept;
+
+} // namespace trace
+
+
+
+// Host span from construction to destruction, free when tracing is off.
+// The name is kept as is, so it must be a string literal
+class TraceScope
+{
+public:
+  explicit TraceScope(const char *name) noexcept
+    : name_(trace::enabled() ? name : nullptr),
+      begin_(name_ != nullptr ? trace::host_now() : 0)
+  {
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+  ~TraceScope();
+
+private:
+  const char *name_;
+  cl_ulong begin_;
+};
+
+namespace detail
+{
+
+// Device command of queue, the event is retained until the trace is written
+void trace_command(cl_command_queue queue, cl_event event,
+                   const char *category, const std::string &name,
+                                                               size_t bytes);
+
+} // namespace detail
+
+} // namespace ocl2
@@ -0,0 +1,123 @@
+//-----------------------------------------------------------------------------
+//
+// Autotuner of local sizes and -D parameters of kernels
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ocl2/kernel.hpp"
+
+namespace ocl2
+{
+
+// One point of a search space
+struct TuneConfig
+{
+  std::vector<std::pair<std::string, long>> defines;
+  std::vector<size_t> local; // empty lets the runtime choose
+  double seconds = 0.0;      // median kernel time measured for it
+
+  // Build options with all the defines, "-DTILE_SIZE=16 -DWPT=4"
+  std::string options() const;
+
+  // Throws if there is no such define
+  long define(const std::string &name) const;
+
+  // Range with the local size of the config, the global size is rounded up
+  // to a multiple of it
+  NDRange range(std::vector<size_t> global) const;
+};
+
+struct TuneSpace
+{
+  // Every combination of the values is tried
+  std::vector<std::pair<std::string, std::vector<long>>> defines;
+
+  // Combinations of defines the kernel can't take, e.g. a tile not
+  // divisible by work per thread
+  std::function<bool(const TuneConfig &config)> valid;
+
+  // Local size fixed by the defines, for kernels with
+  // reqd_work_group_size. Otherwise local sizes are searched
+  std::function<std::vector<size_t>(const TuneConfig &config)> local_for;
+
+  // Candidate local sizes. When empty they are generated from the kernel
+  // limits: multiples of CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE up
+  // to CL_KERNEL_WORK_GROUP_SIZE, in dims dimensions
+  std::vector<std::vector<size_t>> locals;
+  cl_uint dims = 1;
+};
+
+
+
+// Searches the configuration with the least median kernel time, measured
+// with profiling events, and keeps the winner per (device, kernel source,
+// kernel name, shape) in a text file, so later runs skip the search. The
+// context must outlive the tuner
+class Tuner
+{
+public:
+  // Enqueues the kernel with the config on the queue, the kernel is built
+  // with config.options() already
+  using Launch = std::function<Event(Queue &queue, Kernel &kernel,
+                                                   const TuneConfig &config)>;
+
+  explicit Tuner(const Context &context, std::string path = default_path());
+
+  // Stored result if there is one, otherwise the result of the search,
+  // which is stored then. Shape describes the problem size, e.g. "1024x512"
+  TuneConfig tune(const std::string &source, const std::string &kernel_name,
+                  const std::string &shape, const TuneSpace &space,
+                                                       const Launch &launch);
+
+  std::optional<TuneConfig> lookup(const std::string &source,
+                                   const std::string &kernel_name,
+                                   const std::string &shape) const;
+
+  void set_runs(size_t warmup, size_t runs) noexcept
+  {
+    warmup_ = warmup;
+    runs_ = runs;
+  }
+
+  // OCL2_TUNE_FILE environment variable, or tuning.txt under the cache root
+  static std::string default_path();
+
+private:
+  std::string key(const std::string &source, const std::string &kernel_name,
+                                            const std::string &shape) const;
+
+  std::vector<std::vector<size_t>> local_candidates(const TuneSpace &space,
+                          const TuneConfig &config, const Kernel &kernel) const;
+
+  double measure(Kernel &kernel, const TuneConfig &config,
+                                                       const Launch &launch);
+
+  std::map<std::string, TuneConfig> load() const;
+  void store(const std::string &key, const TuneConfig &config);
+
+  const Context &context_;
+  Queue queue_;
+  std::string path_;
+  size_t warmup_ = 1;
+  size_t runs_ = 5;
+};
+
+} // namespace ocl2
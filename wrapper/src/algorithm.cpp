@@ -0,0 +1,272 @@
+//-----------------------------------------------------------------------------
+//
+// Scan, compaction and radix sort kernel sources
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include "ocl2/algorithm.hpp"
+
+namespace ocl2
+{
+namespace detail
+{
+namespace
+{
+
+const char scan_kernels[] = R"(
+__kernel void ocl2_scan_blocks(__global const T *in, __global T *out,
+                               __global T *sums, const ulong size,
+                               const int inclusive, __local T *scratch)
+{
+  const size_t lid = get_local_id(0);
+  const size_t local_size = get_local_size(0);
+  const size_t start = get_group_id(0) * local_size * ITEMS;
+
+  __local T *tile = scratch;
+  __local T *partial = scratch + local_size * ITEMS;
+
+  for(size_t item = 0; item < ITEMS; ++item)
+  {
+    const size_t i = start + item * local_size + lid;
+    tile[item * local_size + lid] = i < size ? in[i] : IDENTITY;
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // Each work-item scans its ITEMS consecutive elements
+  T acc = IDENTITY;
+  for(size_t item = 0; item < ITEMS; ++item)
+  {
+    acc = COMBINE(acc, tile[lid * ITEMS + item]);
+    tile[lid * ITEMS + item] = acc;
+  }
+
+#ifdef WORK_GROUP_SCAN
+  const T prefix = WORK_GROUP_SCAN(acc);
+  const T total = COMBINE(prefix, acc);
+#else
+  partial[lid] = acc;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(size_t offset = 1; offset < local_size; offset *= 2)
+  {
+    const T before = lid >= offset ? partial[lid - offset] : IDENTITY;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    partial[lid] = COMBINE(before, partial[lid]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  const T prefix = lid > 0 ? partial[lid - 1] : IDENTITY;
+  const T total = partial[lid];
+#endif
+
+  for(size_t item = 0; item < ITEMS; ++item)
+    tile[lid * ITEMS + item] = COMBINE(prefix, tile[lid * ITEMS + item]);
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(size_t item = 0; item < ITEMS; ++item)
+  {
+    const size_t j = item * local_size + lid;
+    const size_t i = start + j;
+    if(i < size)
+      out[i] = inclusive ? tile[j] : (j > 0 ? tile[j - 1] : IDENTITY);
+  }
+
+  if(lid == local_size - 1)
+    sums[get_group_id(0)] = total;
+}
+
+__kernel void ocl2_scan_add(__global T *out, __global const T *sums,
+                                                            const ulong size)
+{
+  const size_t local_size = get_local_size(0);
+  const size_t start = get_group_id(0) * local_size * ITEMS;
+  const T prefix = sums[get_group_id(0)];
+
+  for(size_t item = 0; item < ITEMS; ++item)
+  {
+    const size_t i = start + item * local_size + get_local_id(0);
+    if(i < size)
+      out[i] = COMBINE(prefix, out[i]);
+  }
+}
+)";
+
+const char copy_if_kernels[] = R"(
+__kernel void ocl2_copy_if_flags(__global const T *in, __global uint *flags,
+                                                            const ulong size)
+{
+  for(size_t i = get_global_id(0); i < size; i += get_global_size(0))
+  {
+    const T x = in[i];
+    flags[i] = PREDICATE(x) ? 1 : 0;
+  }
+}
+
+__kernel void ocl2_copy_if_scatter(__global const T *in, __global T *out,
+                                   __global const uint *positions,
+                                   __global uint *count, const ulong size)
+{
+  if(size == 0 && get_global_id(0) == 0)
+    *count = 0;
+
+  for(size_t i = get_global_id(0); i < size; i += get_global_size(0))
+  {
+    const T x = in[i];
+    const bool keep = PREDICATE(x);
+    if(keep)
+      out[positions[i]] = x;
+    if(i == size - 1)
+      *count = positions[i] + (keep ? 1 : 0);
+  }
+}
+)";
+
+const char radix_kernels[] = R"(
+#define RADIX (1 << RADIX_BITS)
+#define DIGIT(k, shift) ((KEY_BITS(k) >> (shift)) & (RADIX - 1))
+
+// Digit counts of the tile of every work-group, stored digit-major
+__kernel void ocl2_radix_histogram(__global const K *keys,
+                                   __global uint *counts, const ulong size,
+                                   const uint shift, __local uint *histogram)
+{
+  const size_t lid = get_local_id(0);
+  const size_t local_size = get_local_size(0);
+  const size_t group = get_group_id(0);
+  const size_t start = group * local_size * ITEMS;
+
+  for(size_t digit = lid; digit < RADIX; digit += local_size)
+    histogram[digit] = 0;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(size_t item = 0; item < ITEMS; ++item)
+  {
+    const size_t i = start + item * local_size + lid;
+    if(i < size)
+      atomic_inc(&histogram[DIGIT(keys[i], shift)]);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(size_t digit = lid; digit < RADIX; digit += local_size)
+    counts[digit * get_num_groups(0) + group] = histogram[digit];
+}
+
+// Work-items own ITEMS consecutive keys of the tile, so ranking them by
+// work-item and then in order keeps the sort stable
+__kernel void ocl2_radix_scatter(__global const K *keys_in,
+                                 __global K *keys_out,
+#ifdef V
+                                 __global const V *values_in,
+                                 __global V *values_out,
+#endif
+                                 __global const uint *offsets,
+                                 const ulong size, const uint shift,
+                                 __local uint *prefix)
+{
+  const size_t lid = get_local_id(0);
+  const size_t local_size = get_local_size(0);
+  const size_t group = get_group_id(0);
+  const size_t begin = (group * local_size + lid) * ITEMS;
+
+  uint counts[RADIX];
+  for(size_t digit = 0; digit < RADIX; ++digit)
+    counts[digit] = 0;
+
+  for(size_t item = 0; item < ITEMS; ++item)
+  {
+    const size_t i = begin + item;
+    if(i < size)
+      ++counts[DIGIT(keys_in[i], shift)];
+  }
+
+  for(size_t digit = 0; digit < RADIX; ++digit)
+    prefix[digit * local_size + lid] = counts[digit];
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for(size_t offset = 1; offset < local_size; offset *= 2)
+  {
+    uint before[RADIX];
+    for(size_t digit = 0; digit < RADIX; ++digit)
+    {
+      before[digit] = lid >= offset ?
+                                prefix[digit * local_size + lid - offset] : 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(size_t digit = 0; digit < RADIX; ++digit)
+      prefix[digit * local_size + lid] += before[digit];
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+
+  // First position of every digit of this work-item
+  const size_t groups = get_num_groups(0);
+  for(size_t digit = 0; digit < RADIX; ++digit)
+  {
+    counts[digit] = offsets[digit * groups + group] +
+                      prefix[digit * local_size + lid] - counts[digit];
+  }
+
+  for(size_t item = 0; item < ITEMS; ++item)
+  {
+    const size_t i = begin + item;
+    if(i < size)
+    {
+      const K key = keys_in[i];
+      const uint position = counts[DIGIT(key, shift)]++;
+      keys_out[position] = key;
+#ifdef V
+      values_out[position] = values_in[i];
+#endif
+    }
+  }
+}
+)";
+
+std::string fp64_pragma(bool fp64)
+{
+  return fp64 ? "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n\n" : "";
+}
+
+} // namespace
+
+std::string scan_source(const ReduceType &type, const ReduceOp &op)
+{
+  return reduce_defines(type, op, false, "WORK_GROUP_SCAN",
+                        "scan_exclusive") +
+         "#define ITEMS " + std::to_string(SCAN_ITEMS) + "\n" + scan_kernels;
+}
+
+std::string copy_if_source(const char *type, bool fp64,
+                                                const std::string &predicate)
+{
+  return fp64_pragma(fp64) +
+         "#define T " + type + "\n"
+         "#define PREDICATE(x) (" + predicate + ")\n" + copy_if_kernels;
+}
+
+std::string radix_source(const char *key_type, const char *key_bits,
+                                         const char *value_type, bool fp64)
+{
+  std::string source = fp64_pragma(fp64) +
+                       "#define K " + key_type + "\n"
+                       "#define KEY_BITS(k) (" + key_bits + ")\n"
+                       "#define RADIX_BITS " + std::to_string(RADIX_BITS) +
+                                                                        "\n"
+                       "#define ITEMS " + std::to_string(RADIX_ITEMS) + "\n";
+  if(value_type != nullptr)
+    source += std::string("#define V ") + value_type + "\n";
+
+  return source + radix_kernels;
+}
+
+} // namespace detail
+} // namespace ocl2
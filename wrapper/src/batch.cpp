@@ -0,0 +1,212 @@
+//-----------------------------------------------------------------------------
+//
+// Coalescing of many small launches of one kernel into one launch
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include "ocl2/batch.hpp"
+
+namespace ocl2
+{
+
+Batcher::Batcher(const Context &context, const Program &program,
+                           const std::string &name, const BatchConfig &config)
+  : config_(config), queue_(context), kernel_(program, name)
+{
+  if(config_.max_batch == 0 || config_.local_size == 0)
+    throw Error(CL_INVALID_VALUE, "batch and work-group can't be empty");
+
+  if(kernel_.num_args() < 2)
+  {
+    throw Error(CL_INVALID_KERNEL_ARGS, "batched kernel '" + name +
+                                   "' must take slices and num_slices first");
+  }
+
+  for(int i = 0; i < 2; ++i)
+  {
+    slots_.emplace_back(context, config_.max_batch);
+    slots_.back().host.reserve(config_.max_batch);
+  }
+  pending_.reserve(config_.max_batch);
+
+  timer_ = std::thread([this] { wait_for_deadlines(); });
+}
+
+
+
+Batcher::~Batcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wakeup_.notify_one();
+  timer_.join();
+
+  // Host copies of the slices must outlive their uploads
+  try
+  {
+    queue_.finish();
+  }
+  catch(const Error &)
+  {
+  }
+}
+
+
+
+std::future<Event> Batcher::submit(const BatchSlice &slice,
+                                                         const WaitList &deps)
+{
+  std::future<Event> done;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Retained, the batch is launched after the caller's list is gone
+    for(cl_uint i = 0; i < deps.size(); ++i)
+    {
+      OCL2_CHECK(clRetainEvent(deps.data()[i]));
+      deps_.emplace_back(deps.data()[i]);
+    }
+
+    if(pending_.empty())
+      oldest_ = clock::now();
+
+    pending_.push_back(slice);
+    promises_.emplace_back();
+    done = promises_.back().get_future();
+
+    if(pending_.size() < config_.max_batch &&
+                              config_.max_delay.count() != 0)
+    {
+      // Only the first slice of a batch sets a new deadline
+      if(pending_.size() == 1)
+        wakeup_.notify_one();
+
+      return done;
+    }
+
+    launch_locked();
+  }
+
+  return done;
+}
+
+
+
+void Batcher::flush()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  launch_locked();
+}
+
+
+
+void Batcher::finish()
+{
+  flush();
+  queue_.finish();
+}
+
+
+
+void Batcher::launch_locked() noexcept
+{
+  if(pending_.empty())
+    return;
+
+  std::vector<std::promise<Event>> promises;
+  promises.swap(promises_);
+  std::vector<Event> deps;
+  deps.swap(deps_);
+
+  const size_t count = pending_.size();
+  std::vector<Event> results;
+  std::exception_ptr error;
+
+  try
+  {
+    Slot &slot = slots_[next_slot_];
+    next_slot_ = (next_slot_ + 1) % slots_.size();
+
+    // The upload of the previous batch in this slot reads its host copy
+    if(slot.upload)
+      slot.upload.wait();
+
+    slot.host.swap(pending_);
+    pending_.clear();
+
+    // The queue is in order, so the launch comes after the upload
+    slot.upload = queue_.enqueue_write(slot.device, slot.host.data(), 0,
+                                                                     count);
+    kernel_.set_arg(0, slot.device);
+    kernel_.set_arg(1, cl_uint(count));
+
+    const NDRange range({ count * config_.local_size },
+                                                  { config_.local_size });
+    const Event done = queue_.enqueue_ndrange(kernel_.get(), range, deps);
+    queue_.flush();
+
+    // Every slice gets its own reference to the event of the batch
+    for(size_t i = 0; i < count; ++i)
+    {
+      OCL2_CHECK(clRetainEvent(done.get()));
+      results.emplace_back(done.get());
+    }
+
+    ++launches_;
+    slices_ += count;
+  }
+  catch(...)
+  {
+    pending_.clear();
+    error = std::current_exception();
+  }
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    if(error)
+      promises[i].set_exception(error);
+    else
+      promises[i].set_value(std::move(results[i]));
+  }
+}
+
+
+
+void Batcher::wait_for_deadlines()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  for(;;)
+  {
+    if(pending_.empty())
+    {
+      if(stop_)
+        break;
+
+      wakeup_.wait(lock);
+      continue;
+    }
+
+    const clock::time_point deadline = oldest_ + config_.max_delay;
+    if(stop_ || clock::now() >= deadline)
+    {
+      launch_locked();
+      continue;
+    }
+
+    wakeup_.wait_until(lock, deadline);
+  }
+}
+
+} // namespace ocl2
@@ -0,0 +1,93 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL context and command queue
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "ocl2/context.hpp"
+#include "ocl2/queue.hpp"
+
+namespace ocl2
+{
+
+Context::Context(Device device) : Context(std::vector<Device>{ device })
+{
+}
+
+
+
+Context::Context(const std::vector<Device> &devices) : devices_(devices)
+{
+  if(devices_.empty())
+    throw Error(CL_INVALID_VALUE, "context without devices");
+
+  std::vector<cl_device_id> device_ids;
+  for(const Device &device : devices_)
+    device_ids.push_back(device.get());
+
+  cl_int ret;
+  handle_.reset(clCreateContext(nullptr, cl_uint(device_ids.size()),
+                        device_ids.data(), nullptr, nullptr, &ret));
+  OCL2_CHECK(ret);
+
+  device_ = devices_.front();
+}
+
+
+
+Context::Context(const Context &other, Device device)
+  : device_(device), devices_(other.devices_)
+{
+  if(std::find_if(devices_.begin(), devices_.end(), [&](const Device &d)
+                            { return d.get() == device.get(); }) ==
+                                                              devices_.end())
+  {
+    throw Error(CL_INVALID_DEVICE, "device is not in the context");
+  }
+
+  OCL2_CHECK(clRetainContext(other.get()));
+  handle_.reset(other.get());
+}
+
+
+
+Queue::Queue(const Context &context, cl_command_queue_properties properties)
+  : device_(context.device())
+{
+  cl_int ret;
+
+  if(trace::enabled())
+    properties |= CL_QUEUE_PROFILING_ENABLE;
+
+#if CL_TARGET_OPENCL_VERSION < 200
+  handle_.reset(clCreateCommandQueue(context.get(), device_.get(),
+                                                          properties, &ret));
+#else
+  const cl_queue_properties props[] = { CL_QUEUE_PROPERTIES, properties, 0 };
+  handle_.reset(clCreateCommandQueueWithProperties(context.get(),
+                                                  device_.get(), props, &ret));
+#endif
+  OCL2_CHECK(ret);
+}
+
+
+
+Queue::Queue(const Context &context, Profiler &profiler,
+                                     cl_command_queue_properties properties)
+  : Queue(context, properties | CL_QUEUE_PROFILING_ENABLE)
+{
+  profiler_ = &profiler;
+}
+
+} // namespace ocl2
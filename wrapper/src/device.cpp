@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL device lookup
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include "ocl2/device.hpp"
+
+namespace ocl2
+{
+
+std::vector<Device> Device::all(cl_device_type type)
+{
+  cl_uint num_platforms;
+  OCL2_CHECK(clGetPlatformIDs(0, nullptr, &num_platforms));
+
+  std::vector<cl_platform_id> platform_ids(num_platforms);
+  OCL2_CHECK(clGetPlatformIDs(num_platforms, platform_ids.data(), nullptr));
+
+  std::vector<Device> devices;
+
+  for(cl_platform_id platform_id : platform_ids)
+  {
+    cl_uint num_devices;
+    cl_int ret = clGetDeviceIDs(platform_id, type, 0, nullptr, &num_devices);
+    if(ret == CL_DEVICE_NOT_FOUND)
+      continue;
+    OCL2_CHECK(ret);
+
+    std::vector<cl_device_id> device_ids(num_devices);
+    OCL2_CHECK(clGetDeviceIDs(platform_id, type, num_devices,
+                                                   device_ids.data(), nullptr));
+
+    for(cl_device_id device_id : device_ids)
+      devices.emplace_back(device_id);
+  }
+
+  return devices;
+}
+
+
+
+Device Device::first(cl_device_type type)
+{
+  std::vector<Device> devices = all(type);
+  if(devices.empty())
+    throw Error(CL_DEVICE_NOT_FOUND, "no OpenCL device of requested type");
+
+  return devices.front();
+}
+
+} // namespace ocl2
@@ -0,0 +1,375 @@
+//-----------------------------------------------------------------------------
+//
+// Snapshot of device capabilities and device selection
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+
+#include "ocl2/device_info.hpp"
+#include "ocl2/program.hpp"
+
+namespace ocl2
+{
+namespace
+{
+
+// Bumped whenever fields are added, older lines are queried again
+const char cache_version[] = "ocl2-devices-1";
+
+std::string lower(std::string str)
+{
+  std::transform(str.begin(), str.end(), str.begin(),
+                 [](unsigned char c) { return char(std::tolower(c)); });
+  return str;
+}
+
+// Tabs separate the fields of a line, so strings can't have them
+std::string field(std::string str)
+{
+  std::replace_if(str.begin(), str.end(),
+                  [](char c) { return c == '\t' || c == '\n' || c == '\r'; },
+                  ' ');
+  return str;
+}
+
+std::string platform_string(cl_platform_id platform, cl_platform_info param)
+{
+  return detail::get_info_string(clGetPlatformInfo, platform, param);
+}
+
+// Devices sharing a driver can change places between runs, so the name
+// is part of the key
+using CacheKey = std::tuple<cl_uint, cl_uint, std::string, std::string,
+                                                                std::string>;
+
+CacheKey cache_key(const DeviceInfo &info)
+{
+  return { info.platform_index, info.device_index, info.platform_version,
+                                         info.driver_version, info.name };
+}
+
+// Line per device: version tag, platform and device index, platform and
+// driver version, then the remaining fields
+void write_line(std::ostream &out, const DeviceInfo &info)
+{
+  out << cache_version << "\t" << info.platform_index << "\t"
+      << info.device_index << "\t" << field(info.platform_version) << "\t"
+      << field(info.driver_version) << "\t" << field(info.platform_name)
+      << "\t" << field(info.name) << "\t" << field(info.vendor) << "\t"
+      << field(info.version) << "\t" << field(info.opencl_c_version) << "\t"
+      << field(info.extensions) << "\t" << info.type << "\t"
+      << info.compute_units << "\t" << info.clock_mhz << "\t"
+      << info.global_memory << "\t" << info.local_memory << "\t"
+      << info.max_alloc << "\t" << info.max_work_group_size << "\t"
+      << info.svm << "\t" << info.available << "\t"
+      << info.host_unified_memory << "\n";
+}
+
+bool read_line(const std::string &line, DeviceInfo &info)
+{
+  std::vector<std::string> fields;
+  std::istringstream stream(line);
+  for(std::string value; std::getline(stream, value, '\t');)
+    fields.push_back(value);
+
+  if(fields.size() != 21 || fields[0] != cache_version)
+    return false;
+
+  auto number = [&](size_t i) { return std::strtoull(fields[i].c_str(),
+                                                           nullptr, 10); };
+
+  info.platform_index = cl_uint(number(1));
+  info.device_index = cl_uint(number(2));
+  info.platform_version = fields[3];
+  info.driver_version = fields[4];
+  info.platform_name = fields[5];
+  info.name = fields[6];
+  info.vendor = fields[7];
+  info.version = fields[8];
+  info.opencl_c_version = fields[9];
+  info.extensions = fields[10];
+  info.type = number(11);
+  info.compute_units = cl_uint(number(12));
+  info.clock_mhz = cl_uint(number(13));
+  info.global_memory = number(14);
+  info.local_memory = number(15);
+  info.max_alloc = number(16);
+  info.max_work_group_size = size_t(number(17));
+  info.svm = number(18);
+  info.available = number(19) != 0;
+  info.host_unified_memory = number(20) != 0;
+  return true;
+}
+
+std::map<CacheKey, DeviceInfo> load_cache(const std::string &path)
+{
+  std::map<CacheKey, DeviceInfo> entries;
+  std::ifstream file(path);
+
+  for(std::string line; std::getline(file, line);)
+  {
+    DeviceInfo info;
+    if(read_line(line, info))
+      entries[cache_key(info)] = std::move(info);
+  }
+
+  return entries;
+}
+
+// Rewritten through a temporary file like the tuning results, so
+// concurrent processes never read a partial one
+void store_cache(const std::string &path,
+                                    const std::vector<DeviceInfo> &infos)
+{
+  const size_t slash = path.rfind('/');
+  if(slash != std::string::npos && slash != 0 &&
+                               !detail::make_dirs(path.substr(0, slash)))
+  {
+    return;
+  }
+
+  const std::string tmp_path = path + "." + std::to_string(getpid()) +
+                                                                       ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    for(const DeviceInfo &info : infos)
+      write_line(file, info);
+
+    if(file.flush())
+    {
+      file.close();
+      if(std::rename(tmp_path.c_str(), path.c_str()) == 0)
+        return;
+    }
+  }
+
+  std::remove(tmp_path.c_str());
+}
+
+std::vector<DeviceInfo> take_snapshot(bool use_cache)
+{
+  const std::string path = use_cache ? device_cache_path() : "";
+  const std::map<CacheKey, DeviceInfo> cached = path.empty() ?
+                     std::map<CacheKey, DeviceInfo>() : load_cache(path);
+
+  cl_uint num_platforms;
+  OCL2_CHECK(clGetPlatformIDs(0, nullptr, &num_platforms));
+
+  std::vector<cl_platform_id> platform_ids(num_platforms);
+  OCL2_CHECK(clGetPlatformIDs(num_platforms, platform_ids.data(), nullptr));
+
+  std::vector<DeviceInfo> infos;
+  bool changed = false;
+
+  for(cl_uint p = 0; p < num_platforms; ++p)
+  {
+    cl_uint num_devices;
+    cl_int ret = clGetDeviceIDs(platform_ids[p], CL_DEVICE_TYPE_ALL, 0,
+                                                      nullptr, &num_devices);
+    if(ret == CL_DEVICE_NOT_FOUND)
+      continue;
+    OCL2_CHECK(ret);
+
+    std::vector<cl_device_id> device_ids(num_devices);
+    OCL2_CHECK(clGetDeviceIDs(platform_ids[p], CL_DEVICE_TYPE_ALL,
+                              num_devices, device_ids.data(), nullptr));
+
+    const std::string platform_version = platform_string(platform_ids[p],
+                                                       CL_PLATFORM_VERSION);
+
+    for(cl_uint d = 0; d < num_devices; ++d)
+    {
+      const Device device(device_ids[d]);
+      auto found = cached.end();
+      if(!cached.empty())
+      {
+        found = cached.find({ p, d, field(platform_version),
+                              field(device.info_string(CL_DRIVER_VERSION)),
+                              field(device.name()) });
+      }
+
+      // Availability is a state of the device, not of the driver, so it is
+      // never taken from the file
+      if(found != cached.end())
+      {
+        infos.push_back(found->second);
+        infos.back().device = device;
+        infos.back().available = device.info<cl_bool>(CL_DEVICE_AVAILABLE) ==
+                                                                      CL_TRUE;
+      }
+      else
+      {
+        infos.push_back(DeviceInfo::query(device, p, d));
+        changed = true;
+      }
+    }
+  }
+
+  if(!path.empty() && (changed || cached.size() != infos.size()))
+    store_cache(path, infos);
+
+  return infos;
+}
+
+} // namespace
+
+
+
+bool DeviceInfo::has_extension(const std::string &extension) const
+{
+  std::istringstream stream(extensions);
+  for(std::string name; stream >> name;)
+  {
+    if(name == extension)
+      return true;
+  }
+
+  return false;
+}
+
+
+
+DeviceInfo DeviceInfo::query(Device device, cl_uint platform_index,
+                                                        cl_uint device_index)
+{
+  DeviceInfo info;
+  info.device = device;
+  info.platform_index = platform_index;
+  info.device_index = device_index;
+
+  const cl_platform_id platform = device.platform();
+  info.platform_name = platform_string(platform, CL_PLATFORM_NAME);
+  info.platform_version = platform_string(platform, CL_PLATFORM_VERSION);
+
+  info.name = device.name();
+  info.vendor = device.info_string(CL_DEVICE_VENDOR);
+  info.version = device.info_string(CL_DEVICE_VERSION);
+  info.driver_version = device.info_string(CL_DRIVER_VERSION);
+  info.opencl_c_version = device.info_string(CL_DEVICE_OPENCL_C_VERSION);
+  info.extensions = device.info_string(CL_DEVICE_EXTENSIONS);
+
+  info.type = device.type();
+  info.compute_units = device.info<cl_uint>(CL_DEVICE_MAX_COMPUTE_UNITS);
+  info.clock_mhz = device.info<cl_uint>(CL_DEVICE_MAX_CLOCK_FREQUENCY);
+  info.global_memory = device.info<cl_ulong>(CL_DEVICE_GLOBAL_MEM_SIZE);
+  info.local_memory = device.info<cl_ulong>(CL_DEVICE_LOCAL_MEM_SIZE);
+  info.max_alloc = device.info<cl_ulong>(CL_DEVICE_MAX_MEM_ALLOC_SIZE);
+  info.max_work_group_size = device.info<size_t>(
+                                               CL_DEVICE_MAX_WORK_GROUP_SIZE);
+  info.available = device.info<cl_bool>(CL_DEVICE_AVAILABLE) == CL_TRUE;
+  info.host_unified_memory = device.host_unified_memory();
+
+  // OpenCL 1.x devices don't know the query
+  cl_device_svm_capabilities svm;
+  if(clGetDeviceInfo(device.get(), CL_DEVICE_SVM_CAPABILITIES, sizeof(svm),
+                                              &svm, nullptr) == CL_SUCCESS)
+  {
+    info.svm = svm;
+  }
+
+  return info;
+}
+
+
+
+const std::vector<DeviceInfo> &device_snapshot(bool use_cache)
+{
+  static std::mutex mutex;
+  static std::vector<DeviceInfo> infos;
+  static bool taken = false;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if(!taken)
+  {
+    infos = take_snapshot(use_cache);
+    taken = true;
+  }
+
+  return infos;
+}
+
+
+
+std::string device_cache_path()
+{
+  const char *env_path = std::getenv("OCL2_DEVICE_CACHE");
+  if(env_path != nullptr && env_path[0] != '\0')
+    return std::string(env_path) == "off" ? "" : env_path;
+
+  return detail::cache_root() + "/devices.txt";
+}
+
+
+
+bool DeviceFilter::matches(const DeviceInfo &info) const
+{
+  if((info.type & type_) == 0 || info.global_memory < min_global_memory_)
+    return false;
+
+  if(!name_.empty() &&
+     lower(info.name).find(lower(name_)) == std::string::npos &&
+     lower(info.platform_name).find(lower(name_)) == std::string::npos)
+  {
+    return false;
+  }
+
+  for(const std::string &extension : extensions_)
+  {
+    if(!info.has_extension(extension))
+      return false;
+  }
+
+  return true;
+}
+
+
+
+std::vector<DeviceInfo> select_devices(const DeviceFilter &filter)
+{
+  std::vector<DeviceInfo> selected;
+  for(const DeviceInfo &info : device_snapshot())
+  {
+    if(info.available && filter.matches(info))
+      selected.push_back(info);
+  }
+
+  std::stable_sort(selected.begin(), selected.end(),
+                   [](const DeviceInfo &a, const DeviceInfo &b)
+                   {
+                     return a.peak() > b.peak();
+                   });
+  return selected;
+}
+
+
+
+Device select_device(const DeviceFilter &filter)
+{
+  const std::vector<DeviceInfo> selected = select_devices(filter);
+  if(selected.empty())
+    throw Error(CL_DEVICE_NOT_FOUND, "no OpenCL device matches the filter");
+
+  return selected.front().device;
+}
+
+} // namespace ocl2
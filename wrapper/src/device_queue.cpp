@@ -0,0 +1,80 @@
+//-----------------------------------------------------------------------------
+//
+// On-device queues kernels enqueue child kernels to
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "ocl2/device_queue.hpp"
+
+namespace ocl2
+{
+
+DeviceQueue::DeviceQueue(const Context &context, bool is_default,
+                                                               cl_uint size)
+  : device_(context.device())
+{
+  if(!supported(device_))
+  {
+    throw Error(CL_INVALID_QUEUE_PROPERTIES, "device '" + device_.name() +
+                                       "' can't enqueue kernels from kernels");
+  }
+
+  size_ = std::min(size != 0 ? size : preferred_size(device_),
+                                                         max_size(device_));
+
+  // On-device queues are always out of order, children order themselves
+  // with events or the enqueue flags
+  cl_command_queue_properties properties = CL_QUEUE_ON_DEVICE |
+                                       CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+  if(is_default)
+    properties |= CL_QUEUE_ON_DEVICE_DEFAULT;
+
+  const cl_queue_properties props[] = { CL_QUEUE_PROPERTIES, properties,
+                                        CL_QUEUE_SIZE, size_, 0 };
+  cl_int ret;
+  handle_.reset(clCreateCommandQueueWithProperties(context.get(),
+                                                  device_.get(), props, &ret));
+  OCL2_CHECK(ret);
+}
+
+
+
+bool DeviceQueue::supported(const Device &device)
+{
+  // OpenCL 1.x devices don't know the query
+  cl_command_queue_properties properties;
+  if(clGetDeviceInfo(device.get(), CL_DEVICE_QUEUE_ON_DEVICE_PROPERTIES,
+                     sizeof(properties), &properties, nullptr) != CL_SUCCESS)
+  {
+    return false;
+  }
+
+  return properties != 0;
+}
+
+
+
+cl_uint DeviceQueue::preferred_size(const Device &device)
+{
+  return device.info<cl_uint>(CL_DEVICE_QUEUE_ON_DEVICE_PREFERRED_SIZE);
+}
+
+
+
+cl_uint DeviceQueue::max_size(const Device &device)
+{
+  return device.info<cl_uint>(CL_DEVICE_QUEUE_ON_DEVICE_MAX_SIZE);
+}
+
+} // namespace ocl2
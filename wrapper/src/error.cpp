@@ -0,0 +1,93 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL errors as C++ exceptions
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include "ocl2/error.hpp"
+
+namespace ocl2
+{
+
+const char *error_string(cl_int code) noexcept
+{
+  switch(code)
+  {
+  case CL_SUCCESS: return "success";
+  case CL_DEVICE_NOT_FOUND: return "device not found";
+  case CL_DEVICE_NOT_AVAILABLE: return "device not available";
+  case CL_COMPILER_NOT_AVAILABLE: return "compiler not available";
+  case CL_MEM_OBJECT_ALLOCATION_FAILURE: return "mem object allocation failure";
+  case CL_OUT_OF_RESOURCES: return "out of resources";
+  case CL_OUT_OF_HOST_MEMORY: return "out of host memory";
+  case CL_PROFILING_INFO_NOT_AVAILABLE: return "profiling info not available";
+  case CL_BUILD_PROGRAM_FAILURE: return "build program failure";
+  case CL_MISALIGNED_SUB_BUFFER_OFFSET: return "misaligned sub buffer offset";
+  case CL_INVALID_VALUE: return "invalid value";
+  case CL_INVALID_DEVICE_TYPE: return "invalid device type";
+  case CL_INVALID_PLATFORM: return "invalid platform";
+  case CL_INVALID_DEVICE: return "invalid device";
+  case CL_INVALID_CONTEXT: return "invalid context";
+  case CL_INVALID_QUEUE_PROPERTIES: return "invalid queue properties";
+  case CL_INVALID_COMMAND_QUEUE: return "invalid command queue";
+  case CL_INVALID_HOST_PTR: return "invalid host ptr";
+  case CL_INVALID_MEM_OBJECT: return "invalid mem object";
+  case CL_INVALID_SAMPLER: return "invalid sampler";
+  case CL_INVALID_BINARY: return "invalid binary";
+  case CL_INVALID_BUILD_OPTIONS: return "invalid build options";
+  case CL_INVALID_PROGRAM: return "invalid program";
+  case CL_INVALID_PROGRAM_EXECUTABLE: return "invalid program executable";
+  case CL_INVALID_KERNEL_NAME: return "invalid kernel name";
+  case CL_INVALID_KERNEL_DEFINITION: return "invalid kernel definition";
+  case CL_INVALID_KERNEL: return "invalid kernel";
+  case CL_INVALID_ARG_INDEX: return "invalid arg index";
+  case CL_INVALID_ARG_VALUE: return "invalid arg value";
+  case CL_INVALID_ARG_SIZE: return "invalid arg size";
+  case CL_INVALID_KERNEL_ARGS: return "invalid kernel args";
+  case CL_INVALID_WORK_DIMENSION: return "invalid work dimension";
+  case CL_INVALID_WORK_GROUP_SIZE: return "invalid work group size";
+  case CL_INVALID_WORK_ITEM_SIZE: return "invalid work item size";
+  case CL_INVALID_GLOBAL_OFFSET: return "invalid global offset";
+  case CL_INVALID_EVENT_WAIT_LIST: return "invalid event wait list";
+  case CL_INVALID_EVENT: return "invalid event";
+  case CL_INVALID_OPERATION: return "invalid operation";
+  case CL_INVALID_BUFFER_SIZE: return "invalid buffer size";
+  case CL_INVALID_GLOBAL_WORK_SIZE: return "invalid global work size";
+  case CL_INVALID_PROPERTY: return "invalid property";
+  case CL_INVALID_DEVICE_QUEUE: return "invalid device queue";
+  }
+
+  return "unknown";
+}
+
+
+
+Error::Error(cl_int code, const char *filename, int line)
+  : std::runtime_error(std::string("'") + error_string(code) + "' at " +
+                       filename + ":" + std::to_string(line) +
+                       " with return code " + std::to_string(code)),
+    code_(code)
+{
+}
+
+Error::Error(cl_int code, const std::string &what)
+  : std::runtime_error(what), code_(code)
+{
+}
+
+BuildError::BuildError(cl_int code, std::string log)
+  : Error(code, std::string("build program failure:\n") + log),
+    log_(std::move(log))
+{
+}
+
+} // namespace ocl2
@@ -0,0 +1,106 @@
+//-----------------------------------------------------------------------------
+//
+// Fused elementwise kernels: source generation and the kernel cache
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "ocl2/expr.hpp"
+
+namespace ocl2
+{
+namespace detail
+{
+
+std::string ExprWriter::param_list() const
+{
+  std::string list;
+  for(const std::string &param : params_)
+    list += ", " + param;
+  return list;
+}
+
+std::string ExprWriter::source(const char *out_type, bool out_fp64,
+                                                const std::string &value) const
+{
+  std::string source;
+  if(fp64_ || out_fp64)
+    source += "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n\n";
+
+  source += "__kernel void ocl2_expr(__global ";
+  source += out_type;
+  source += " *out" + param_list() + ", const ulong size)\n"
+            "{\n"
+            "  for(size_t i = get_global_id(0); i < size;"
+                                               " i += get_global_size(0))\n"
+            "    out[i] = (";
+  source += out_type;
+  source += ")" + value + ";\n"
+            "}\n";
+
+  return source;
+}
+
+GeneratedKernel &generated_kernel(const Context &context,
+                                  const std::string &source,
+                                  const std::string &name,
+                                  const std::string &options)
+{
+  struct GeneratedProgram
+  {
+    Program program;
+    std::map<std::string, std::unique_ptr<GeneratedKernel>> kernels;
+  };
+
+  // Programs retain their context, so a context handle in a key can't be
+  // reused by another context while the entry lives. Devices sharing a
+  // context get programs of their own
+  static std::mutex mutex;
+  static std::map<std::tuple<cl_context, cl_device_id, std::string,
+                 std::string>, std::unique_ptr<GeneratedProgram>> programs;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::unique_ptr<GeneratedProgram> &program = programs[{ context.get(),
+                                 context.device().get(), source, options }];
+  if(!program)
+  {
+    program.reset(new GeneratedProgram{
+                     Program::build_cached(context, source, options), {} });
+  }
+
+  std::unique_ptr<GeneratedKernel> &entry = program->kernels[name];
+  if(!entry)
+    entry = std::make_unique<GeneratedKernel>(program->program, name);
+
+  return *entry;
+}
+
+size_t generated_local_size(const Kernel &kernel, const Device &device)
+{
+  size_t max_local;
+  OCL2_CHECK(clGetKernelWorkGroupInfo(kernel.get(), device.get(),
+                          CL_KERNEL_WORK_GROUP_SIZE, sizeof(max_local),
+                          &max_local, nullptr));
+
+  size_t local = 1;
+  while(local * 2 <= max_local && local < 256)
+    local *= 2;
+
+  return local;
+}
+
+} // namespace detail
+} // namespace ocl2
@@ -0,0 +1,236 @@
+//-----------------------------------------------------------------------------
+//
+// Host thread pool of the reference computations
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <exception>
+#include <thread>
+
+#include "ocl2/host_reference.hpp"
+
+namespace ocl2
+{
+namespace host
+{
+namespace
+{
+
+// Block of B is BLOCK_INNER rows of BLOCK_COLS elements, it stays in L2
+// while a block of BLOCK_ROWS rows of A goes over it. Inside the block
+// MICRO_ROWS x MICRO_COLS elements of C are kept in vector registers
+enum { BLOCK_ROWS = 16, BLOCK_INNER = 256, BLOCK_COLS = 256 };
+enum { MICRO_ROWS = 2, MICRO_COLS = 32 };
+
+// Baseline x86-64 has no 32-bit vector multiply, so an AVX2 version of the
+// multiplication is built too and picked at load time where it runs. The
+// loops are flattened into each version to be compiled for its target
+#if defined(__x86_64__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define OCL2_SIMD_CLONES \
+                 __attribute__((target_clones("avx2", "default"), flatten))
+#endif
+#endif
+
+#ifndef OCL2_SIMD_CLONES
+#define OCL2_SIMD_CLONES
+#endif
+
+// Adds A[rows x inner] * B[inner x cols] to C[rows x cols], the constant
+// sizes of full tiles turn the loops into vector code after inlining
+template <typename T>
+inline void micro_tile(const T *A, const T *B, T *C, size_t m, size_t k,
+                                   size_t inner, size_t rows, size_t cols)
+{
+  T acc[MICRO_ROWS][MICRO_COLS];
+
+  for(size_t r = 0; r < rows; ++r)
+    for(size_t j = 0; j < cols; ++j)
+      acc[r][j] = C[r * k + j];
+
+  for(size_t l = 0; l < inner; ++l)
+  {
+    const T *b = B + l * k;
+    for(size_t r = 0; r < rows; ++r)
+    {
+      const T a = A[r * m + l];
+      for(size_t j = 0; j < cols; ++j)
+        acc[r][j] += a * b[j];
+    }
+  }
+
+  for(size_t r = 0; r < rows; ++r)
+    for(size_t j = 0; j < cols; ++j)
+      C[r * k + j] = acc[r][j];
+}
+
+template <typename T>
+inline void multiply_rows(const T *A, const T *B, T *C, size_t m, size_t k,
+                                           size_t row_begin, size_t row_end)
+{
+  std::fill(C + row_begin * k, C + row_end * k, T(0));
+
+  for(size_t inner = 0; inner < m; inner += BLOCK_INNER)
+  {
+    const size_t inner_size = std::min<size_t>(BLOCK_INNER, m - inner);
+
+    for(size_t col = 0; col < k; col += BLOCK_COLS)
+    {
+      const size_t col_end = std::min<size_t>(col + BLOCK_COLS, k);
+
+      for(size_t i = row_begin; i < row_end; i += MICRO_ROWS)
+      {
+        for(size_t j = col; j < col_end; j += MICRO_COLS)
+        {
+          const T *A_tile = A + i * m + inner;
+          const T *B_tile = B + inner * k + j;
+          T *C_tile = C + i * k + j;
+
+          if(i + MICRO_ROWS <= row_end && j + MICRO_COLS <= col_end)
+          {
+            micro_tile(A_tile, B_tile, C_tile, m, k, inner_size,
+                                                    MICRO_ROWS, MICRO_COLS);
+          }
+          else
+          {
+            micro_tile(A_tile, B_tile, C_tile, m, k, inner_size,
+                       std::min<size_t>(MICRO_ROWS, row_end - i),
+                       std::min<size_t>(MICRO_COLS, col_end - j));
+          }
+        }
+      }
+    }
+  }
+}
+
+OCL2_SIMD_CLONES
+void multiply_rows_int(const cl_int *A, const cl_int *B, cl_int *C,
+                       size_t m, size_t k, size_t row_begin, size_t row_end)
+{
+  multiply_rows(A, B, C, m, k, row_begin, row_end);
+}
+
+OCL2_SIMD_CLONES
+void multiply_rows_float(const cl_float *A, const cl_float *B, cl_float *C,
+                       size_t m, size_t k, size_t row_begin, size_t row_end)
+{
+  multiply_rows(A, B, C, m, k, row_begin, row_end);
+}
+
+OCL2_SIMD_CLONES
+void multiply_rows_double(const cl_double *A, const cl_double *B,
+                          cl_double *C, size_t m, size_t k,
+                                         size_t row_begin, size_t row_end)
+{
+  multiply_rows(A, B, C, m, k, row_begin, row_end);
+}
+
+} // namespace
+
+unsigned threads()
+{
+  static const unsigned count = []
+  {
+    if(const char *value = std::getenv("OCL2_HOST_THREADS"))
+    {
+      const int requested = std::atoi(value);
+      if(requested > 0)
+        return unsigned(requested);
+    }
+
+    return std::max(std::thread::hardware_concurrency(), 1u);
+  }();
+
+  return count;
+}
+
+
+
+void parallel_for(size_t count, size_t grain,
+                  const std::function<void(size_t begin, size_t end)> &body)
+{
+  grain = std::max<size_t>(grain, 1);
+  const size_t chunks = (count + grain - 1) / grain;
+  const size_t workers = std::min<size_t>(threads(), chunks);
+
+  if(workers <= 1)
+  {
+    if(count != 0)
+      body(0, count);
+    return;
+  }
+
+  std::atomic<size_t> next{ 0 };
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto work = [&]
+  {
+    try
+    {
+      for(size_t chunk = next++; chunk < chunks; chunk = next++)
+        body(chunk * grain, std::min(count, (chunk + 1) * grain));
+    }
+    catch(...)
+    {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      if(!error)
+        error = std::current_exception();
+      next = chunks;
+    }
+  };
+
+  // The calling thread is one of the workers
+  std::vector<std::thread> pool;
+  for(size_t i = 1; i < workers; ++i)
+    pool.emplace_back(work);
+  work();
+
+  for(std::thread &thread : pool)
+    thread.join();
+
+  if(error)
+    std::rethrow_exception(error);
+}
+
+
+
+void matrix_mult(const cl_int *A, const cl_int *B, cl_int *C, size_t n,
+                                                        size_t m, size_t k)
+{
+  parallel_for(n, BLOCK_ROWS, [=](size_t row_begin, size_t row_end)
+  {
+    multiply_rows_int(A, B, C, m, k, row_begin, row_end);
+  });
+}
+
+void matrix_mult(const cl_float *A, const cl_float *B, cl_float *C,
+                                              size_t n, size_t m, size_t k)
+{
+  parallel_for(n, BLOCK_ROWS, [=](size_t row_begin, size_t row_end)
+  {
+    multiply_rows_float(A, B, C, m, k, row_begin, row_end);
+  });
+}
+
+void matrix_mult(const cl_double *A, const cl_double *B, cl_double *C,
+                                              size_t n, size_t m, size_t k)
+{
+  parallel_for(n, BLOCK_ROWS, [=](size_t row_begin, size_t row_end)
+  {
+    multiply_rows_double(A, B, C, m, k, row_begin, row_end);
+  });
+}
+
+} // namespace host
+} // namespace ocl2
@@ -0,0 +1,171 @@
+//-----------------------------------------------------------------------------
+//
+// Work split across the devices of all platforms
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+#include "ocl2/multi_device.hpp"
+
+namespace ocl2
+{
+
+MultiDevice::MultiDevice(cl_device_type type)
+  : MultiDevice(Device::all(type))
+{
+}
+
+
+
+MultiDevice::MultiDevice(const std::vector<Device> &devices)
+{
+  if(devices.empty())
+    throw Error(CL_DEVICE_NOT_FOUND, "no OpenCL device to split work across");
+
+  std::vector<cl_platform_id> platforms;
+  std::map<cl_platform_id, std::vector<Device>> platform_devices;
+  for(const Device &device : devices)
+  {
+    std::vector<Device> &same = platform_devices[device.platform()];
+    if(same.empty())
+      platforms.push_back(device.platform());
+    same.push_back(device);
+  }
+
+  members_.reserve(devices.size());
+
+  for(cl_platform_id platform : platforms)
+  {
+    const Context shared(platform_devices[platform]);
+
+    for(const Device &device : shared.devices())
+    {
+      const double estimate = double(
+                       device.info<cl_uint>(CL_DEVICE_MAX_COMPUTE_UNITS)) *
+                       device.info<cl_uint>(CL_DEVICE_MAX_CLOCK_FREQUENCY);
+      members_.emplace_back(Context(shared, device),
+                                                   std::max(estimate, 1.0));
+    }
+  }
+}
+
+
+
+double MultiDevice::throughput(size_t i) const
+{
+  const Member &member = members_[i];
+  if(member.throughput > 0.0)
+    return member.throughput;
+
+  double measured = 0.0, estimated = 0.0;
+  for(const Member &other : members_)
+  {
+    if(other.throughput > 0.0)
+    {
+      measured += other.throughput;
+      estimated += other.estimate;
+    }
+  }
+
+  return estimated > 0.0 ? member.estimate * measured / estimated :
+                           member.estimate;
+}
+
+
+
+std::vector<Share> MultiDevice::split(size_t total, size_t granularity) const
+{
+  granularity = std::max<size_t>(granularity, 1);
+  const size_t units = (total + granularity - 1) / granularity;
+
+  std::vector<double> weights(size());
+  for(size_t i = 0; i < size(); ++i)
+    weights[i] = throughput(i);
+  const double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+  // Largest remainder rounding of the ideal unit counts
+  std::vector<size_t> counts(size());
+  std::vector<std::pair<double, size_t>> remainders;
+  size_t given = 0;
+  for(size_t i = 0; i < size(); ++i)
+  {
+    const double ideal = units * weights[i] / sum;
+    counts[i] = std::min(size_t(ideal), units - given);
+    given += counts[i];
+    remainders.emplace_back(ideal - counts[i], i);
+  }
+
+  std::sort(remainders.begin(), remainders.end(),
+            [](const std::pair<double, size_t> &a,
+               const std::pair<double, size_t> &b) { return a.first > b.first; });
+  for(size_t j = 0; given < units; j = (j + 1) % remainders.size(), ++given)
+    ++counts[remainders[j].second];
+
+  std::vector<Share> shares;
+  size_t offset = 0;
+  for(size_t i = 0; i < size(); ++i)
+  {
+    if(counts[i] == 0)
+      continue;
+
+    const size_t count = std::min(counts[i] * granularity, total - offset);
+    shares.push_back({ i, offset, count });
+    offset += count;
+  }
+
+  return shares;
+}
+
+
+
+void MultiDevice::Completion::finish(size_t i, cl_int status_)
+{
+  const auto end = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  seconds[i] = std::chrono::duration<double>(end - start[i]).count();
+  if(status_ < 0)
+    status = status_;
+
+  if(--pending == 0)
+    all_done.notify_all();
+}
+
+
+
+void MultiDevice::wait(Completion &done, const std::vector<Share> &shares)
+{
+  {
+    TraceScope scope("MultiDevice::wait");
+    std::unique_lock<std::mutex> lock(done.mutex);
+    done.all_done.wait(lock, [&] { return done.pending == 0; });
+  }
+
+  if(done.status != CL_SUCCESS)
+    throw Error(done.status, "multi-device launch failed");
+
+  for(size_t i = 0; i < shares.size(); ++i)
+  {
+    Member &member = members_[shares[i].device];
+    const double measured = shares[i].count /
+                                        std::max(done.seconds[i], 1e-9);
+
+    member.throughput = member.throughput > 0.0 ?
+              smoothing_ * measured + (1.0 - smoothing_) * member.throughput :
+              measured;
+  }
+}
+
+} // namespace ocl2
@@ -0,0 +1,191 @@
+//-----------------------------------------------------------------------------
+//
+// Device memory pool handing out sub-buffers of large slabs
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "ocl2/pool.hpp"
+
+namespace ocl2
+{
+
+BufferPool::BufferPool(const Context &context, size_t slab_bytes,
+                                                       cl_mem_flags flags)
+  : context_(context.get()), flags_(flags)
+{
+  const Device &device = context.device();
+
+  // Reported in bits
+  alignment_ = std::max<size_t>(
+                      device.info<cl_uint>(CL_DEVICE_MEM_BASE_ADDR_ALIGN) / 8,
+                                                                           1);
+
+  const size_t max_alloc = device.info<cl_ulong>(CL_DEVICE_MAX_MEM_ALLOC_SIZE);
+  slab_bytes_ = std::max(size_class(std::min(slab_bytes, max_alloc)),
+                                                                 alignment_);
+  if(slab_bytes_ > max_alloc)
+    slab_bytes_ /= 2;
+}
+
+
+
+void BufferPool::collect()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  collect_locked();
+}
+
+
+
+PoolStats BufferPool::stats() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+
+
+detail::PoolBlock BufferPool::acquire_block(size_t bytes)
+{
+  const size_t block_bytes = size_class(bytes);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  ++stats_.requests;
+  stats_.in_use_bytes += block_bytes;
+  stats_.requested_bytes += bytes;
+
+  collect_locked();
+
+  auto bin = bins_.find(block_bytes);
+  if(bin != bins_.end() && !bin->second.empty())
+  {
+    detail::PoolBlock block = bin->second.back();
+    bin->second.pop_back();
+
+    ++stats_.hits;
+    stats_.cached_bytes -= block_bytes;
+    return block;
+  }
+
+  try
+  {
+    return carve(block_bytes);
+  }
+  catch(...)
+  {
+    --stats_.requests;
+    stats_.in_use_bytes -= block_bytes;
+    stats_.requested_bytes -= bytes;
+    throw;
+  }
+}
+
+
+
+void BufferPool::release_block(detail::PoolBlock block, size_t requested_bytes,
+                                                               Event last_use)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  stats_.in_use_bytes -= block.bytes;
+  stats_.requested_bytes -= requested_bytes;
+  stats_.cached_bytes += block.bytes;
+
+  if(last_use)
+    pending_.push_back({ block, std::move(last_use) });
+  else
+    bins_[block.bytes].push_back(block);
+}
+
+
+
+size_t BufferPool::size_class(size_t bytes) const noexcept
+{
+  size_t block_bytes = alignment_;
+  while(block_bytes < bytes)
+    block_bytes *= 2;
+
+  return block_bytes;
+}
+
+
+
+// Blocks larger than a slab are buffers of their own, the current slab
+// keeps serving the smaller ones
+detail::PoolBlock BufferPool::carve(size_t bytes)
+{
+  cl_int ret;
+  detail::PoolBlock block;
+  block.bytes = bytes;
+
+  if(bytes > slab_bytes_)
+  {
+    MemHandle mem(clCreateBuffer(context_, flags_, bytes, nullptr, &ret));
+    OCL2_CHECK(ret);
+
+    ++stats_.slabs;
+    stats_.reserved_bytes += bytes;
+
+    block.mem = mem.get();
+    blocks_.push_back(std::move(mem));
+    return block;
+  }
+
+  if(slabs_.empty() || slabs_.back().bytes - slabs_.back().used < bytes)
+  {
+    MemHandle mem(clCreateBuffer(context_, flags_, slab_bytes_, nullptr,
+                                                                       &ret));
+    OCL2_CHECK(ret);
+
+    if(!slabs_.empty())
+      stats_.wasted_bytes += slabs_.back().bytes - slabs_.back().used;
+
+    slabs_.push_back({ std::move(mem), slab_bytes_, 0 });
+
+    ++stats_.slabs;
+    stats_.reserved_bytes += slab_bytes_;
+  }
+
+  Slab &slab = slabs_.back();
+  const cl_buffer_region region = { slab.used, bytes };
+  MemHandle mem(clCreateSubBuffer(slab.mem.get(), 0,
+                               CL_BUFFER_CREATE_TYPE_REGION, &region, &ret));
+  OCL2_CHECK(ret);
+
+  slab.used += bytes;
+
+  block.mem = mem.get();
+  blocks_.push_back(std::move(mem));
+  return block;
+}
+
+
+
+// Failed commands release their memory too, status is negative then
+void BufferPool::collect_locked()
+{
+  auto done = std::partition(pending_.begin(), pending_.end(),
+                             [](const Pending &pending)
+                             {
+                               return pending.last_use.status() > CL_COMPLETE;
+                             });
+
+  for(auto it = done; it != pending_.end(); ++it)
+    bins_[it->block.bytes].push_back(it->block);
+
+  pending_.erase(done, pending_.end());
+}
+
+} // namespace ocl2
@@ -0,0 +1,147 @@
+//-----------------------------------------------------------------------------
+//
+// Per-command profiling of queues
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <iomanip>
+#include <map>
+#include <ostream>
+
+#include "ocl2/profiler.hpp"
+
+namespace ocl2
+{
+
+void Profiler::record(cl_event event, std::string name, size_t bytes)
+{
+  OCL2_CHECK(clRetainEvent(event));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  records_.push_back({ EventHandle(event), std::move(name), bytes, 0.0 });
+}
+
+
+
+void Profiler::annotate(const Event &event, double flops, size_t bytes)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for(auto it = records_.rbegin(); it != records_.rend(); ++it)
+  {
+    if(it->event.get() != event.get())
+      continue;
+
+    it->flops = flops;
+    if(bytes != 0)
+      it->bytes = bytes;
+    return;
+  }
+
+  throw Error(CL_INVALID_EVENT, "event was not recorded by the profiler");
+}
+
+
+
+std::vector<CommandProfile> Profiler::results() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<CommandProfile> profiles;
+
+  for(const Record &record : records_)
+  {
+    OCL2_CHECK(clWaitForEvents(1, record.event.address()));
+
+    auto timestamp = [&](cl_profiling_info param)
+    {
+      return detail::get_info<cl_ulong>(clGetEventProfilingInfo,
+                                               record.event.get(), param);
+    };
+
+    CommandProfile profile;
+    profile.name = record.name;
+    profile.bytes = record.bytes;
+    profile.flops = record.flops;
+    profile.queued = timestamp(CL_PROFILING_COMMAND_QUEUED);
+    profile.submit = timestamp(CL_PROFILING_COMMAND_SUBMIT);
+    profile.start = timestamp(CL_PROFILING_COMMAND_START);
+    profile.end = timestamp(CL_PROFILING_COMMAND_END);
+    profiles.push_back(profile);
+  }
+
+  return profiles;
+}
+
+
+
+void Profiler::report(std::ostream &os) const
+{
+  const std::vector<CommandProfile> profiles = results();
+
+  struct Total
+  {
+    size_t count = 0;
+    double time = 0.0;
+    double bytes = 0.0;
+    double flops = 0.0;
+  };
+  std::map<std::string, Total> totals;
+
+  const std::ios::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(3);
+
+  os << std::left << std::setw(24) << "command" << std::right
+     << std::setw(14) << "queued, ms" << std::setw(14) << "exec, ms"
+     << std::setw(12) << "GB/s" << std::setw(12) << "GFLOPS" << "\n";
+
+  for(const CommandProfile &profile : profiles)
+  {
+    os << std::left << std::setw(24) << profile.name << std::right
+       << std::setw(14) << profile.queue_delay() * 1e3
+       << std::setw(14) << profile.execution_time() * 1e3
+       << std::setw(12) << profile.bandwidth() * 1e-9
+       << std::setw(12) << profile.gflops() << "\n";
+
+    Total &total = totals[profile.name];
+    ++total.count;
+    total.time += profile.execution_time();
+    total.bytes += profile.bytes;
+    total.flops += profile.flops;
+  }
+
+  os << "\n" << std::left << std::setw(24) << "total" << std::right
+     << std::setw(14) << "count" << std::setw(14) << "exec, ms"
+     << std::setw(12) << "GB/s" << std::setw(12) << "GFLOPS" << "\n";
+
+  for(const auto &[name, total] : totals)
+  {
+    os << std::left << std::setw(24) << name << std::right
+       << std::setw(14) << total.count << std::setw(14) << total.time * 1e3
+       << std::setw(12) << (total.time > 0 ? total.bytes * 1e-9 / total.time :
+                                                                          0.0)
+       << std::setw(12) << (total.time > 0 ? total.flops * 1e-9 / total.time :
+                                                                          0.0)
+       << "\n";
+  }
+
+  os.flags(flags);
+}
+
+
+
+void Profiler::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  records_.clear();
+}
+
+} // namespace ocl2
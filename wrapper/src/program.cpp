@@ -0,0 +1,381 @@
+//-----------------------------------------------------------------------------
+//
+// OpenCL program and its on-disk binary cache
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ocl2/program.hpp"
+#include "ocl2/trace.hpp"
+
+namespace ocl2
+{
+namespace
+{
+
+// The key and the file layout match examples/raw_ocl/cl_program_cache.c
+const char cache_magic[8] = { 'O', 'C', 'L', '2', 'P', 'R', 'G', '1' };
+
+uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+
+  for(size_t i = 0; i < size; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+std::string cache_dir()
+{
+  const char *env_dir = std::getenv("OCL2_PROGRAM_CACHE_DIR");
+  if(env_dir != nullptr && env_dir[0] != '\0')
+    return env_dir;
+
+  return detail::cache_root() + "/programs";
+}
+
+bool load_binary(const std::string &path, uint64_t key,
+                                           std::vector<unsigned char> &binary)
+{
+  std::ifstream file(path, std::ios::binary);
+
+  char magic[sizeof(cache_magic)];
+  uint64_t stored_key;
+  uint64_t binary_size;
+
+  if(!file.read(magic, sizeof(magic)) ||
+     std::memcmp(magic, cache_magic, sizeof(magic)) != 0 ||
+     !file.read(reinterpret_cast<char *>(&stored_key), sizeof(stored_key)) ||
+     stored_key != key ||
+     !file.read(reinterpret_cast<char *>(&binary_size), sizeof(binary_size)) ||
+     binary_size == 0)
+  {
+    return false;
+  }
+
+  binary.resize(binary_size);
+  return static_cast<bool>(file.read(reinterpret_cast<char *>(binary.data()),
+                                                                 binary_size));
+}
+
+// Binary is written to a temporary file first so that concurrent runs never
+// see a partially written entry
+void store_binary(const std::string &path, uint64_t key,
+                                      const std::vector<unsigned char> &binary)
+{
+  if(binary.empty() || !detail::make_dirs(cache_dir()))
+    return;
+
+  const std::string tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+
+  {
+    std::ofstream file(tmp_path, std::ios::binary);
+    const uint64_t binary_size = binary.size();
+
+    file.write(cache_magic, sizeof(cache_magic));
+    file.write(reinterpret_cast<const char *>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char *>(&binary_size),
+                                                          sizeof(binary_size));
+    file.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+
+    if(file.flush())
+    {
+      file.close();
+      if(std::rename(tmp_path.c_str(), path.c_str()) == 0)
+        return;
+    }
+  }
+
+  std::remove(tmp_path.c_str());
+}
+
+// OpenCL 1.x devices don't know the query
+bool takes_spirv(const Device &device)
+{
+  size_t size;
+  if(clGetDeviceInfo(device.get(), CL_DEVICE_IL_VERSION, 0, nullptr,
+                                                        &size) != CL_SUCCESS)
+  {
+    return false;
+  }
+
+  return device.info_string(CL_DEVICE_IL_VERSION).find("SPIR-V") !=
+                                                            std::string::npos;
+}
+
+} // namespace
+
+
+
+namespace detail
+{
+
+uint64_t program_key(const Device &device, const std::string &source,
+                                                    const std::string &options)
+{
+  uint64_t hash = 14695981039346656037ull;
+
+  hash = fnv1a(hash, source.data(), source.size());
+  hash = fnv1a(hash, "", 1);
+
+  const std::string name = device.name();
+  hash = fnv1a(hash, name.c_str(), name.size() + 1);
+
+  const std::string driver = device.info_string(CL_DRIVER_VERSION);
+  hash = fnv1a(hash, driver.c_str(), driver.size() + 1);
+
+  return fnv1a(hash, options.data(), options.size());
+}
+
+
+
+std::string cache_root()
+{
+  const char *home = std::getenv("HOME");
+  return std::string((home != nullptr) ? home : ".") + "/.cache/ocl2";
+}
+
+
+
+bool make_dirs(const std::string &path)
+{
+  for(size_t pos = path.find('/', 1); pos != std::string::npos;
+                                               pos = path.find('/', pos + 1))
+  {
+    if(mkdir(path.substr(0, pos).c_str(), 0755) != 0 && errno != EEXIST)
+      return false;
+  }
+
+  return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+} // namespace detail
+
+
+
+Program Program::from_source(const Context &context, const std::string &source)
+{
+  cl_int ret;
+  const char *source_str = source.c_str();
+  const size_t source_size = source.size();
+
+  cl_program program = clCreateProgramWithSource(context.get(), 1,
+                                          &source_str, &source_size, &ret);
+  OCL2_CHECK(ret);
+
+  return Program(program, context.device());
+}
+
+
+
+Program Program::from_binary(const Context &context,
+                                       const std::vector<unsigned char> &binary)
+{
+  cl_int ret;
+  cl_int binary_status;
+  cl_device_id device_id = context.device().get();
+  const unsigned char *binary_ptr = binary.data();
+  const size_t binary_size = binary.size();
+
+  cl_program program = clCreateProgramWithBinary(context.get(), 1, &device_id,
+                          &binary_size, &binary_ptr, &binary_status, &ret);
+  Program result(program, context.device());
+  OCL2_CHECK(ret);
+  OCL2_CHECK(binary_status);
+
+  return result;
+}
+
+
+
+Program Program::from_file(const Context &context, const std::string &filename)
+{
+  return from_source(context, read_file(filename));
+}
+
+
+
+Program Program::from_il(const Context &context, const void *il,
+                                                                 size_t size)
+{
+  cl_int ret;
+  cl_program program = clCreateProgramWithIL(context.get(), il, size, &ret);
+  OCL2_CHECK(ret);
+
+  return Program(program, context.device());
+}
+
+
+
+Program Program::build_from(const Context &context,
+                            const ProgramSource &source,
+                            const std::string &options, bool use_cache)
+{
+  if(source.spirv_size != 0 && options.find("-D") == std::string::npos &&
+                                               takes_spirv(context.device()))
+  {
+    // Drivers may still reject the module, the text is built then
+    try
+    {
+      Program program = from_il(context, source.spirv, source.spirv_size);
+      program.build(options);
+      return program;
+    }
+    catch(const Error &)
+    {
+    }
+  }
+
+  const std::string text(source.text, source.size);
+  if(use_cache)
+    return build_cached(context, text, options);
+
+  Program program = from_source(context, text);
+  program.build(options);
+  return program;
+}
+
+
+
+Program Program::build_cached(const Context &context,
+                              const std::string &source,
+                              const std::string &options)
+{
+  char name[32];
+  const uint64_t key = detail::program_key(context.device(), source,
+                                                                     options);
+  std::snprintf(name, sizeof(name), "/%016llx.bin",
+                                        static_cast<unsigned long long>(key));
+  const std::string path = cache_dir() + name;
+
+  std::vector<unsigned char> binary;
+  if(load_binary(path, key, binary))
+  {
+    // Any failure here is a cache miss, the source build below decides
+    try
+    {
+      Program program = from_binary(context, binary);
+      program.build(options);
+      return program;
+    }
+    catch(const Error &)
+    {
+      std::remove(path.c_str());
+    }
+  }
+
+  Program program = from_source(context, source);
+  program.build(options);
+
+  // The cache is only a shortcut, the program is built either way
+  try
+  {
+    store_binary(path, key, program.binary());
+  }
+  catch(const Error &)
+  {
+  }
+
+  return program;
+}
+
+
+
+void Program::build(const std::string &options)
+{
+  TraceScope scope("Program::build");
+  cl_device_id device_id = device_.get();
+  cl_int ret = clBuildProgram(get(), 1, &device_id, options.c_str(),
+                                                             nullptr, nullptr);
+
+  if(ret == CL_BUILD_PROGRAM_FAILURE)
+    throw BuildError(ret, build_log());
+  OCL2_CHECK(ret);
+}
+
+
+
+std::string Program::build_log() const
+{
+  size_t size;
+  OCL2_CHECK(clGetProgramBuildInfo(get(), device_.get(), CL_PROGRAM_BUILD_LOG,
+                                                           0, nullptr, &size));
+
+  std::string log(size, '\0');
+  OCL2_CHECK(clGetProgramBuildInfo(get(), device_.get(), CL_PROGRAM_BUILD_LOG,
+                                                      size, &log[0], nullptr));
+  while(!log.empty() && log.back() == '\0')
+    log.pop_back();
+
+  return log;
+}
+
+
+
+std::vector<unsigned char> Program::binary() const
+{
+  // Programs are created for every device of the context but built for
+  // device_ only, the binaries come as one entry per device
+  const cl_uint num_devices = detail::get_info<cl_uint>(clGetProgramInfo,
+                                                 get(), CL_PROGRAM_NUM_DEVICES);
+
+  std::vector<cl_device_id> devices(num_devices);
+  OCL2_CHECK(clGetProgramInfo(get(), CL_PROGRAM_DEVICES,
+                  num_devices * sizeof(cl_device_id), devices.data(), nullptr));
+
+  const auto found = std::find(devices.begin(), devices.end(), device_.get());
+  if(found == devices.end())
+    throw Error(CL_INVALID_DEVICE, "program is not for its device");
+  const size_t index = size_t(found - devices.begin());
+
+  std::vector<size_t> sizes(num_devices);
+  OCL2_CHECK(clGetProgramInfo(get(), CL_PROGRAM_BINARY_SIZES,
+                          num_devices * sizeof(size_t), sizes.data(), nullptr));
+
+  // Null entries are skipped, so only the binary of device_ is copied
+  std::vector<unsigned char> binary(sizes[index]);
+  std::vector<unsigned char *> binaries(num_devices, nullptr);
+  binaries[index] = binary.data();
+  OCL2_CHECK(clGetProgramInfo(get(), CL_PROGRAM_BINARIES,
+              num_devices * sizeof(unsigned char *), binaries.data(), nullptr));
+
+  return binary;
+}
+
+
+
+std::string read_file(const std::string &filename)
+{
+  std::ifstream file(filename, std::ios::binary);
+  if(!file)
+    throw std::runtime_error("can't open file '" + filename + "'");
+
+  return std::string(std::istreambuf_iterator<char>(file),
+                                            std::istreambuf_iterator<char>());
+}
+
+} // namespace ocl2
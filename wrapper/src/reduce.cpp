@@ -0,0 +1,111 @@
+//-----------------------------------------------------------------------------
+//
+// Reduction kernel source and launch parameters
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <cstdio>
+
+#include "ocl2/reduce.hpp"
+
+namespace ocl2
+{
+namespace detail
+{
+
+std::string reduce_defines(const ReduceType &type, const ReduceOp &op,
+                           bool fp64, const char *macro, const char *function)
+{
+  std::string source;
+  if(fp64 || type.fp64)
+    source += "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n\n";
+
+  source += std::string("#define T ") + type.name + "\n"
+            "#define T_MIN " + type.lowest + "\n"
+            "#define T_MAX " + type.highest + "\n"
+            "#define IDENTITY (" + op.identity + ")\n"
+            "#define COMBINE(a, b) (" + op.combine + ")\n\n";
+
+  // Work-group functions are core in OpenCL C 2.x and optional in 3.0
+  if(type.collective && !op.builtin.empty())
+  {
+    source += "#if __OPENCL_C_VERSION__ >= 200 && "
+              "(__OPENCL_C_VERSION__ < 300 || "
+              "defined(__opencl_c_work_group_collective_functions))\n"
+              "#define " + std::string(macro) + " work_group_" + function +
+                                                     "_" + op.builtin + "\n"
+              "#endif\n\n";
+  }
+
+  return source;
+}
+
+std::string reduce_source(const ExprWriter &writer, const ReduceType &type,
+                          const ReduceOp &op, const std::string &value)
+{
+  std::string source = reduce_defines(type, op, writer.uses_fp64(),
+                                              "WORK_GROUP_REDUCE", "reduce");
+
+  source += "__kernel void ocl2_reduce(__global T *out" +
+            writer.param_list() + ",\n"
+            "                          const ulong size, __local T *scratch)\n"
+            "{\n"
+            "  T acc = IDENTITY;\n"
+            "  for(size_t i = get_global_id(0); i < size;"
+                                               " i += get_global_size(0))\n"
+            "  {\n"
+            "    const T x = (T)" + value + ";\n"
+            "    acc = COMBINE(acc, x);\n"
+            "  }\n"
+            "\n"
+            "#ifdef WORK_GROUP_REDUCE\n"
+            "  acc = WORK_GROUP_REDUCE(acc);\n"
+            "#else\n"
+            "  const size_t lid = get_local_id(0);\n"
+            "  scratch[lid] = acc;\n"
+            "  barrier(CLK_LOCAL_MEM_FENCE);\n"
+            "\n"
+            "  for(size_t offset = get_local_size(0) / 2; offset > 0;"
+                                                           " offset /= 2)\n"
+            "  {\n"
+            "    if(lid < offset)\n"
+            "      scratch[lid] = COMBINE(scratch[lid], scratch[lid + offset]);\n"
+            "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+            "  }\n"
+            "\n"
+            "  acc = scratch[0];\n"
+            "#endif\n"
+            "\n"
+            "  if(get_local_id(0) == 0)\n"
+            "    out[get_group_id(0)] = acc;\n"
+            "}\n";
+
+  return source;
+}
+
+std::string reduce_options(const Device &device)
+{
+  // "OpenCL C <major>.<minor> <vendor-specific information>"
+  const std::string version = device.info_string(CL_DEVICE_OPENCL_C_VERSION);
+
+  int major = 0, minor = 0;
+  if(std::sscanf(version.c_str(), "OpenCL C %d.%d", &major, &minor) != 2 ||
+                                                                   major < 2)
+  {
+    return "";
+  }
+
+  return "-cl-std=CL" + std::to_string(major) + "." + std::to_string(minor);
+}
+
+} // namespace detail
+} // namespace ocl2
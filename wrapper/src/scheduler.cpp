@@ -0,0 +1,162 @@
+//-----------------------------------------------------------------------------
+//
+// Task graph scheduled over several queues or an out-of-order queue
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <limits>
+
+#include "ocl2/scheduler.hpp"
+
+namespace ocl2
+{
+
+TaskId TaskGraph::add(TaskFunction function, std::vector<TaskId> deps,
+                                                          std::string name)
+{
+  const TaskId id = tasks_.size();
+  for(TaskId dep : deps)
+  {
+    if(dep >= id)
+      throw Error(CL_INVALID_VALUE, "task depends on a later task");
+  }
+
+  tasks_.push_back({ std::move(function), std::move(deps), std::move(name) });
+  return id;
+}
+
+
+
+Scheduler::Scheduler(const Context &context, size_t num_queues,
+                                       cl_command_queue_properties properties)
+{
+  if(num_queues == 0)
+    throw Error(CL_INVALID_VALUE, "scheduler needs a queue");
+
+  queues_.reserve(num_queues);
+  for(size_t i = 0; i < num_queues; ++i)
+    queues_.emplace_back(context, properties);
+}
+
+
+
+Scheduler Scheduler::out_of_order(const Context &context,
+                                       cl_command_queue_properties properties)
+{
+  if(!supports_out_of_order(context.device()))
+  {
+    throw Error(CL_INVALID_QUEUE_PROPERTIES,
+                                      "device has no out-of-order queues");
+  }
+
+  std::vector<Queue> queues;
+  queues.emplace_back(context,
+                       properties | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE);
+  return Scheduler(std::move(queues));
+}
+
+
+
+bool Scheduler::supports_out_of_order(const Device &device)
+{
+  return (device.info<cl_command_queue_properties>(
+                               CL_DEVICE_QUEUE_ON_HOST_PROPERTIES) &
+                                CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0;
+}
+
+
+
+std::vector<Event> Scheduler::enqueue(const TaskGraph &graph,
+                                                        const WaitList &deps)
+{
+  TraceScope scope("Scheduler::enqueue");
+  const TaskId none = std::numeric_limits<TaskId>::max();
+
+  std::vector<Event> events(graph.size());
+  std::vector<size_t> queue_of(graph.size());
+  std::vector<TaskId> last(queues_.size(), none);
+  std::vector<bool> flushed(queues_.size(), true);
+
+  for(TaskId id = 0; id < graph.size(); ++id)
+  {
+    const TaskGraph::Task &task = graph.task(id);
+
+    // Continuing a chain on its queue keeps it in order without the
+    // device waiting on an event of another queue
+    size_t target = queues_.size();
+    for(TaskId dep : task.deps)
+    {
+      if(last[queue_of[dep]] == dep)
+      {
+        target = queue_of[dep];
+        break;
+      }
+    }
+
+    if(target == queues_.size())
+    {
+      target = next_;
+      next_ = (next_ + 1) % queues_.size();
+    }
+
+    // Events of other queues must be flushed to the device before a
+    // command waits for them, or it may wait forever
+    WaitList wait;
+    if(task.deps.empty())
+      wait.add(deps);
+
+    for(TaskId dep : task.deps)
+    {
+      wait.add(events[dep]);
+      if(queue_of[dep] != target && !flushed[queue_of[dep]])
+      {
+        queues_[queue_of[dep]].flush();
+        flushed[queue_of[dep]] = true;
+      }
+    }
+
+    Queue &queue = queues_[target];
+    events[id] = task.function(queue, wait);
+
+    // A task without an event is done once all commands of its queue are,
+    // the ones it enqueued included, and wait is. A marker on wait alone
+    // would not cover them on an out-of-order queue
+    if(!events[id])
+    {
+      WaitList done = wait;
+      done.add(queue.enqueue_marker());
+      events[id] = queue.enqueue_marker(done);
+    }
+
+    queue_of[id] = target;
+    last[target] = id;
+    flushed[target] = false;
+  }
+
+  for(size_t i = 0; i < queues_.size(); ++i)
+  {
+    if(!flushed[i])
+      queues_[i].flush();
+  }
+
+  return events;
+}
+
+
+
+void Scheduler::run(const TaskGraph &graph, const WaitList &deps)
+{
+  const std::vector<Event> events = enqueue(graph, deps);
+  WaitList(events).wait();
+}
+
+} // namespace ocl2
@@ -0,0 +1,219 @@
+//-----------------------------------------------------------------------------
+//
+// Kernel submission from many host threads through a lock-free ring
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <sstream>
+
+#include "ocl2/submitter.hpp"
+
+namespace ocl2
+{
+namespace
+{
+
+// Launches the dispatcher takes from the ring before flushing the queues
+enum { BATCH_SIZE = 64 };
+
+} // namespace
+
+
+
+namespace detail
+{
+
+// The ring outlives the enqueue call of the producer, so the events are
+// retained instead of borrowed like a WaitList does
+Submission::Submission(std::unique_ptr<Kernel> kernel,
+                       std::shared_ptr<KernelRing> free, const NDRange &range,
+                                        const WaitList &deps, size_t shard)
+  : kernel(std::move(kernel)), free(std::move(free)), range(range),
+                                                                shard(shard)
+{
+  for(cl_uint i = 0; i < deps.size(); ++i)
+  {
+    OCL2_CHECK(clRetainEvent(deps.data()[i]));
+    this->deps.emplace_back(deps.data()[i]);
+  }
+}
+
+} // namespace detail
+
+
+
+const std::shared_ptr<detail::KernelRing> &Submitter::Producer::kernels(
+                                                     const std::string &name)
+{
+  auto found = free_.find(name);
+  if(found != free_.end())
+    return found->second;
+
+  // Names are never changed after the constructor, so reading them from
+  // any thread is safe
+  if(submitter_->names_.count(name) == 0)
+    throw Error(CL_INVALID_KERNEL_NAME, "no kernel '" + name + "'");
+
+  // No more of them can be in flight than launches fit into the ring
+  return free_.emplace(name, std::make_shared<detail::KernelRing>(
+                                   submitter_->capacity_)).first->second;
+}
+
+
+
+Submitter::Submitter(const Context &context, const Program &program,
+                     size_t num_queues, size_t capacity,
+                     cl_command_queue_properties properties)
+  : capacity_(capacity), ring_(capacity)
+{
+  if(num_queues == 0)
+    throw Error(CL_INVALID_VALUE, "submitter needs a queue");
+
+  // Producers create their kernels from it on their own threads
+  OCL2_CHECK(clRetainProgram(program.get()));
+  program_.reset(program.get());
+
+  std::istringstream names(detail::get_info_string(clGetProgramInfo,
+                                      program.get(), CL_PROGRAM_KERNEL_NAMES));
+  for(std::string name; std::getline(names, name, ';');)
+  {
+    if(!name.empty())
+      names_.insert(name);
+  }
+
+  queues_.reserve(num_queues);
+  for(size_t i = 0; i < num_queues; ++i)
+    queues_.emplace_back(context, properties);
+
+  dispatcher_ = std::thread([this] { dispatch(); });
+}
+
+
+
+Submitter::~Submitter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wakeup_.notify_one();
+  dispatcher_.join();
+}
+
+
+
+Submitter::Producer Submitter::producer()
+{
+  return Producer(*this, next_shard_++ % queues_.size());
+}
+
+
+
+void Submitter::finish()
+{
+  TraceScope scope("Submitter::finish");
+  const size_t submitted = submitted_.load();
+  while(dispatched_.load() < submitted)
+    std::this_thread::yield();
+
+  // clFinish is safe to call while the dispatcher enqueues more
+  for(Queue &queue : queues_)
+    queue.finish();
+}
+
+
+
+void Submitter::push(SubmissionPtr &submission)
+{
+  ++submitted_;
+  while(!ring_.try_push(submission))
+  {
+    wake();
+    std::this_thread::yield();
+  }
+
+  wake();
+}
+
+
+
+// A producer pushes and then reads sleeping_, the dispatcher sets it and
+// then looks at the ring. The fences order both pairs, so either the
+// producer sees the flag or the dispatcher sees the launch
+void Submitter::wake()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if(sleeping_.load(std::memory_order_relaxed))
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wakeup_.notify_one();
+  }
+}
+
+
+
+void Submitter::dispatch()
+{
+  std::vector<bool> touched(queues_.size());
+  SubmissionPtr submission;
+
+  for(;;)
+  {
+    size_t batch = 0;
+    while(batch < BATCH_SIZE && ring_.try_pop(submission))
+    {
+      try
+      {
+        const WaitList deps(submission->deps);
+        submission->done.set_value(queues_[submission->shard].enqueue_ndrange(
+                 submission->kernel->get(), submission->range, deps));
+        touched[submission->shard] = true;
+      }
+      catch(...)
+      {
+        submission->done.set_exception(std::current_exception());
+      }
+
+      // The arguments were taken by the enqueue, the kernel object can be
+      // bound again. It is released if the producer already has plenty
+      submission->free->try_push(submission->kernel);
+      submission.reset();
+      ++batch;
+    }
+
+    // Nothing here may throw, a failed flush shows up in the events
+    if(batch != 0)
+    {
+      for(size_t i = 0; i < queues_.size(); ++i)
+      {
+        if(touched[i])
+          clFlush(queues_[i].get());
+        touched[i] = false;
+      }
+
+      dispatched_ += batch;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if(stop_ && !ring_.ready())
+      break;
+
+    wakeup_.wait(lock, [this] { return stop_ || ring_.ready(); });
+    sleeping_.store(false, std::memory_order_relaxed);
+  }
+}
+
+} // namespace ocl2
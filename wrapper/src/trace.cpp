@@ -0,0 +1,321 @@
+//-----------------------------------------------------------------------------
+//
+// Chrome trace timeline of queue and host activity
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ocl2/device.hpp"
+#include "ocl2/handle.hpp"
+#include "ocl2/trace.hpp"
+
+namespace ocl2
+{
+namespace
+{
+
+const char *trace_path() noexcept
+{
+  const char *path = std::getenv("OCL2_TRACE");
+  return (path != nullptr && path[0] != '\0') ? path : nullptr;
+}
+
+std::string escaped(const std::string &str)
+{
+  std::string result;
+
+  for(char c : str)
+  {
+    if(c == '"' || c == '\\')
+      result += '\\';
+    if(static_cast<unsigned char>(c) >= 0x20)
+      result += c;
+  }
+
+  return result;
+}
+
+// Device timestamps are on the device clock. Each queue is shifted by the
+// smallest difference between the host time right after an enqueue and
+// the QUEUED timestamp of that command, which keeps the relative device
+// timing exact and puts it on the host timeline
+class Tracer
+{
+public:
+  static Tracer &instance()
+  {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  ~Tracer()
+  {
+    try
+    {
+      write();
+    }
+    catch(...)
+    {
+    }
+  }
+
+  void command(cl_command_queue queue, cl_event event, const char *category,
+                                      const std::string &name, size_t bytes)
+  {
+    const cl_ulong now = trace::host_now();
+    OCL2_CHECK(clRetainEvent(event));
+    EventHandle handle(event);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if(queues_.find(queue) == queues_.end())
+    {
+      cl_device_id device;
+      OCL2_CHECK(clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE,
+                                           sizeof(device), &device, nullptr));
+
+      const int id = int(queues_.size()) + 1;
+      queues_[queue] = { id, "queue " + std::to_string(id) + ": " +
+                                                      Device(device).name() };
+    }
+
+    commands_.push_back({ queue, std::move(handle), category, name, bytes,
+                                                                      now });
+  }
+
+  void span(const char *name, cl_ulong begin, cl_ulong end)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto thread = threads_.emplace(std::this_thread::get_id(),
+                                               int(threads_.size()) + 1);
+    spans_.push_back({ name, begin, end, thread.first->second });
+  }
+
+  void write();
+
+private:
+  struct Queue
+  {
+    int id;
+    std::string label;
+  };
+
+  struct Command
+  {
+    cl_command_queue queue;
+    EventHandle event;
+    const char *category;
+    std::string name;
+    size_t bytes;
+    cl_ulong host_time;
+  };
+
+  struct Span
+  {
+    const char *name;
+    cl_ulong begin;
+    cl_ulong end;
+    int thread;
+  };
+
+  Tracer() : path_(trace_path()) {}
+
+  const char *path_;
+
+  std::mutex mutex_;
+  std::map<cl_command_queue, Queue> queues_;
+  std::map<std::thread::id, int> threads_;
+  std::vector<Command> commands_;
+  std::vector<Span> spans_;
+};
+
+
+
+void Tracer::write()
+{
+  if(path_ == nullptr)
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  struct Timestamps
+  {
+    cl_ulong queued, submit, start, end;
+  };
+
+  std::vector<Timestamps> timestamps(commands_.size());
+  std::vector<bool> valid(commands_.size(), false);
+  std::map<cl_command_queue, double> offsets;
+
+  for(size_t i = 0; i < commands_.size(); ++i)
+  {
+    const Command &command = commands_[i];
+    Timestamps &times = timestamps[i];
+
+    // Failed commands have no timestamps and are left out
+    if(clWaitForEvents(1, command.event.address()) != CL_SUCCESS)
+      continue;
+
+    const cl_event event = command.event.get();
+    if(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED,
+                         sizeof(cl_ulong), &times.queued, nullptr) != 0 ||
+       clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT,
+                         sizeof(cl_ulong), &times.submit, nullptr) != 0 ||
+       clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START,
+                         sizeof(cl_ulong), &times.start, nullptr) != 0 ||
+       clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END,
+                         sizeof(cl_ulong), &times.end, nullptr) != 0)
+    {
+      continue;
+    }
+
+    valid[i] = true;
+
+    const double offset = double(command.host_time) - double(times.queued);
+    auto found = offsets.emplace(command.queue, offset);
+    found.first->second = std::min(found.first->second, offset);
+  }
+
+  // Timeline starts with the earliest recorded activity
+  double origin = std::numeric_limits<double>::max();
+  for(size_t i = 0; i < commands_.size(); ++i)
+  {
+    if(valid[i])
+      origin = std::min(origin, timestamps[i].queued +
+                                               offsets[commands_[i].queue]);
+  }
+  for(const Span &span : spans_)
+    origin = std::min(origin, double(span.begin));
+
+  auto micros = [origin](double host_time)
+  {
+    return (host_time - origin) * 1e-3;
+  };
+
+  std::ofstream file(path_);
+  file << "{\"traceEvents\":[\n"
+       << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+          "\"args\":{\"name\":\"host\"}},\n"
+       << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"device queues\"}}";
+
+  for(const auto &[queue, info] : queues_)
+  {
+    file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+         << info.id << ",\"args\":{\"name\":\"" << escaped(info.label)
+         << "\"}}";
+  }
+
+  for(size_t i = 0; i < commands_.size(); ++i)
+  {
+    if(!valid[i])
+      continue;
+
+    const Command &command = commands_[i];
+    const Timestamps &times = timestamps[i];
+    const double offset = offsets[command.queue];
+
+    file << ",\n{\"name\":\"" << escaped(command.name) << "\",\"cat\":\""
+         << command.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+         << queues_[command.queue].id
+         << ",\"ts\":" << micros(times.start + offset)
+         << ",\"dur\":" << (times.end - times.start) * 1e-3
+         << ",\"args\":{\"bytes\":" << command.bytes
+         << ",\"queue_delay_us\":" << (times.start - times.queued) * 1e-3
+         << ",\"submit_delay_us\":" << (times.submit - times.queued) * 1e-3
+         << "}}";
+  }
+
+  for(const Span &span : spans_)
+  {
+    file << ",\n{\"name\":\"" << escaped(span.name)
+         << "\",\"cat\":\"host\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+         << span.thread << ",\"ts\":" << micros(double(span.begin))
+         << ",\"dur\":" << (span.end - span.begin) * 1e-3 << "}";
+  }
+
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+} // namespace
+
+
+
+namespace trace
+{
+
+bool enabled() noexcept
+{
+  static const bool is_enabled = (trace_path() != nullptr);
+  return is_enabled;
+}
+
+
+
+void flush()
+{
+  if(enabled())
+    Tracer::instance().write();
+}
+
+
+
+cl_ulong host_now() noexcept
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace trace
+
+
+
+TraceScope::~TraceScope()
+{
+  if(name_ == nullptr)
+    return;
+
+  try
+  {
+    Tracer::instance().span(name_, begin_, trace::host_now());
+  }
+  catch(...)
+  {
+  }
+}
+
+
+
+namespace detail
+{
+
+void trace_command(cl_command_queue queue, cl_event event,
+                   const char *category, const std::string &name,
+                                                                size_t bytes)
+{
+  if(trace::enabled() && event != nullptr)
+    Tracer::instance().command(queue, event, category, name, bytes);
+}
+
+} // namespace detail
+
+} // namespace ocl2
@@ -0,0 +1,405 @@
+//-----------------------------------------------------------------------------
+//
+// Autotuner of local sizes and -D parameters of kernels
+//
+//-----------------------------------------------------------------------------
+//
+// Copyright © 2020 Yuly Tarasov. All rights reserved.
+//
+//-----------------------------------------------------------------------------
+//
+// This file is licensed after LGPL v3
+// Look at: https://www.gnu.org/licenses/lgpl-3.0.en.html for details
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include <unistd.h>
+
+#include "ocl2/tuner.hpp"
+
+namespace ocl2
+{
+namespace
+{
+
+size_t kernel_size_info(const Kernel &kernel, const Device &device,
+                                              cl_kernel_work_group_info param)
+{
+  size_t value;
+  OCL2_CHECK(clGetKernelWorkGroupInfo(kernel.get(), device.get(), param,
+                                                sizeof(value), &value, nullptr));
+  return value;
+}
+
+size_t product(const std::vector<size_t> &sizes)
+{
+  size_t result = 1;
+  for(size_t size : sizes)
+    result *= size;
+  return result;
+}
+
+std::string local_string(const std::vector<size_t> &local)
+{
+  if(local.empty())
+    return "auto";
+
+  std::string result;
+  for(size_t i = 0; i < local.size(); ++i)
+    result += (i == 0 ? "" : "x") + std::to_string(local[i]);
+  return result;
+}
+
+std::vector<size_t> parse_local(const std::string &str)
+{
+  std::vector<size_t> local;
+  if(str == "auto")
+    return local;
+
+  std::istringstream stream(str);
+  std::string part;
+  while(std::getline(stream, part, 'x'))
+    local.push_back(std::strtoull(part.c_str(), nullptr, 10));
+  return local;
+}
+
+// All combinations of the define values, the last define changes fastest
+std::vector<TuneConfig> define_combinations(const TuneSpace &space)
+{
+  std::vector<TuneConfig> configs(1);
+
+  for(const auto &[name, values] : space.defines)
+  {
+    std::vector<TuneConfig> next;
+    for(const TuneConfig &config : configs)
+    {
+      for(long value : values)
+      {
+        TuneConfig extended = config;
+        extended.defines.emplace_back(name, value);
+        next.push_back(extended);
+      }
+    }
+    configs = std::move(next);
+  }
+
+  return configs;
+}
+
+} // namespace
+
+
+
+std::string TuneConfig::options() const
+{
+  std::string result;
+  for(const auto &[name, value] : defines)
+    result += (result.empty() ? "-D" : " -D") + name + "=" +
+                                                        std::to_string(value);
+  return result;
+}
+
+
+
+long TuneConfig::define(const std::string &name) const
+{
+  for(const auto &define : defines)
+  {
+    if(define.first == name)
+      return define.second;
+  }
+
+  throw Error(CL_INVALID_VALUE, "tuning config has no define '" + name + "'");
+}
+
+
+
+NDRange TuneConfig::range(std::vector<size_t> global) const
+{
+  if(local.empty())
+    return NDRange(global, local);
+
+  if(local.size() != global.size())
+    throw Error(CL_INVALID_WORK_DIMENSION, "local and global sizes differ in "
+                                                               "dimensions");
+
+  for(size_t i = 0; i < global.size(); ++i)
+    global[i] = (global[i] + local[i] - 1) / local[i] * local[i];
+
+  return NDRange(global, local);
+}
+
+
+
+Tuner::Tuner(const Context &context, std::string path)
+  : context_(context), queue_(context, CL_QUEUE_PROFILING_ENABLE),
+    path_(std::move(path))
+{
+}
+
+
+
+TuneConfig Tuner::tune(const std::string &source,
+                       const std::string &kernel_name,
+                       const std::string &shape, const TuneSpace &space,
+                                                        const Launch &launch)
+{
+  if(std::optional<TuneConfig> stored = lookup(source, kernel_name, shape))
+    return *stored;
+
+  TuneConfig best;
+  best.seconds = std::numeric_limits<double>::max();
+
+  for(TuneConfig config : define_combinations(space))
+  {
+    if(space.valid && !space.valid(config))
+      continue;
+
+    // A define combination the device can't build is just not a candidate
+    std::optional<Program> program;
+    try
+    {
+      program = Program::build_cached(context_, source, config.options());
+    }
+    catch(const Error &)
+    {
+      continue;
+    }
+
+    Kernel kernel(*program, kernel_name);
+
+    for(std::vector<size_t> &local : local_candidates(space, config, kernel))
+    {
+      config.local = std::move(local);
+
+      try
+      {
+        config.seconds = measure(kernel, config, launch);
+      }
+      catch(const Error &)
+      {
+        continue;
+      }
+
+      if(config.seconds < best.seconds)
+        best = config;
+    }
+  }
+
+  if(best.seconds == std::numeric_limits<double>::max())
+  {
+    throw Error(CL_INVALID_VALUE, "no configuration of '" + kernel_name +
+                                                              "' could run");
+  }
+
+  store(key(source, kernel_name, shape), best);
+  return best;
+}
+
+
+
+std::optional<TuneConfig> Tuner::lookup(const std::string &source,
+                                        const std::string &kernel_name,
+                                        const std::string &shape) const
+{
+  const std::map<std::string, TuneConfig> results = load();
+
+  auto found = results.find(key(source, kernel_name, shape));
+  if(found == results.end())
+    return std::nullopt;
+
+  return found->second;
+}
+
+
+
+std::string Tuner::default_path()
+{
+  const char *env_path = std::getenv("OCL2_TUNE_FILE");
+  if(env_path != nullptr && env_path[0] != '\0')
+    return env_path;
+
+  return detail::cache_root() + "/tuning.txt";
+}
+
+
+
+// Whitespace separates the fields of the file, so it can't be in the key
+std::string Tuner::key(const std::string &source,
+                       const std::string &kernel_name,
+                       const std::string &shape) const
+{
+  auto field = [](std::string str)
+  {
+    std::replace_if(str.begin(), str.end(),
+                    [](char c) { return std::isspace(c) != 0; }, '_');
+    return str;
+  };
+
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(
+                  detail::program_key(context_.device(), source, "")));
+
+  return std::string(hash) + " " + field(kernel_name) + " " + field(shape);
+}
+
+
+
+std::vector<std::vector<size_t>> Tuner::local_candidates(
+                                     const TuneSpace &space,
+                                     const TuneConfig &config,
+                                     const Kernel &kernel) const
+{
+  const Device &device = context_.device();
+  const size_t max_size = kernel_size_info(kernel, device,
+                                                   CL_KERNEL_WORK_GROUP_SIZE);
+
+  std::vector<std::vector<size_t>> candidates;
+
+  if(space.local_for)
+    candidates.push_back(space.local_for(config));
+  else if(!space.locals.empty())
+    candidates = space.locals;
+  else
+  {
+    const size_t multiple = std::max<size_t>(1, kernel_size_info(kernel,
+                  device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE));
+
+    candidates.push_back({});
+
+    if(space.dims == 1)
+    {
+      for(size_t size = multiple; size <= max_size; size *= 2)
+        candidates.push_back({ size });
+    }
+    else
+    {
+      for(size_t x = 1; x <= max_size; x *= 2)
+      {
+        for(size_t y = 1; x * y <= max_size; y *= 2)
+        {
+          if(x * y < multiple || (x * y) % multiple != 0)
+            continue;
+
+          std::vector<size_t> local = { x, y };
+          local.resize(space.dims, 1);
+          candidates.push_back(local);
+        }
+      }
+    }
+  }
+
+  candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                   [max_size](const std::vector<size_t> &local)
+                   {
+                     return product(local) > max_size;
+                   }), candidates.end());
+
+  return candidates;
+}
+
+
+
+double Tuner::measure(Kernel &kernel, const TuneConfig &config,
+                                                        const Launch &launch)
+{
+  for(size_t i = 0; i < warmup_; ++i)
+    launch(queue_, kernel, config).wait();
+
+  std::vector<double> seconds;
+
+  for(size_t i = 0; i < std::max<size_t>(runs_, 1); ++i)
+  {
+    Event event = launch(queue_, kernel, config);
+    event.wait();
+    seconds.push_back((event.profiling(CL_PROFILING_COMMAND_END) -
+                       event.profiling(CL_PROFILING_COMMAND_START)) * 1e-9);
+  }
+
+  std::nth_element(seconds.begin(), seconds.begin() + seconds.size() / 2,
+                                                               seconds.end());
+  return seconds[seconds.size() / 2];
+}
+
+
+
+// Line per result: key (hash, kernel, shape), seconds, local, options
+std::map<std::string, TuneConfig> Tuner::load() const
+{
+  std::map<std::string, TuneConfig> results;
+  std::ifstream file(path_);
+  std::string line;
+
+  while(std::getline(file, line))
+  {
+    std::istringstream stream(line);
+    std::string hash, kernel_name, shape, local, define;
+    TuneConfig config;
+
+    if(!(stream >> hash >> kernel_name >> shape >> config.seconds >> local))
+      continue;
+
+    config.local = parse_local(local);
+
+    while(stream >> define)
+    {
+      const size_t eq = define.find('=');
+      if(define.compare(0, 2, "-D") != 0 || eq == std::string::npos)
+        continue;
+
+      config.defines.emplace_back(define.substr(2, eq - 2),
+                          std::strtol(define.c_str() + eq + 1, nullptr, 10));
+    }
+
+    results[hash + " " + kernel_name + " " + shape] = config;
+  }
+
+  return results;
+}
+
+
+
+// Whole file is rewritten through a temporary one, so concurrent runs
+// never read a partial file
+void Tuner::store(const std::string &key, const TuneConfig &config)
+{
+  std::map<std::string, TuneConfig> results = load();
+  results[key] = config;
+
+  const size_t slash = path_.rfind('/');
+  if(slash != std::string::npos && slash != 0 &&
+                              !detail::make_dirs(path_.substr(0, slash)))
+  {
+    return;
+  }
+
+  const std::string tmp_path = path_ + "." + std::to_string(getpid()) +
+                                                                       ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    for(const auto &[result_key, result] : results)
+    {
+      file << result_key << " " << result.seconds << " "
+           << local_string(result.local) << " " << result.options() << "\n";
+    }
+
+    if(file.flush())
+    {
+      file.close();
+      if(std::rename(tmp_path.c_str(), path_.c_str()) == 0)
+        return;
+    }
+  }
+
+  std::remove(tmp_path.c_str());
+}
+
+} // namespace ocl2